@@ -0,0 +1,495 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <limits>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <stdlib.h>
+#include <time.h>
+
+#include "state.hpp"
+#include "game.hpp"
+#include "ntnn.hpp"
+#include "spscqueue.hpp"
+
+using namespace std;
+
+#define NUM_TUPLES 17
+#define TUPLE_LENGTH 4
+
+/* These values are the parameters that define an experiment.
+ * GAMES: The number of games to play, shared among the actors
+ * ALPHA: The NTNN's learning rate
+ * NUM_ACTORS: The number of actor threads, which play the games (0 for
+ *             one per core left over by the learners)
+ * NUM_LEARNERS: The number of learner threads, which train the agent
+ * SNAPSHOT_INTERVAL: How many training updates must pass before the
+ *                    actors are given a new snapshot of the agent?
+ * QUEUE_SIZE: The number of transitions each actor can have waiting to
+ *             be learned from, before it must wait for the learners
+ * WEIGHT_TYPE: Type of the value function's weights
+ */
+#define GAMES 100000
+#define ALPHA 0.005
+#define NUM_ACTORS 0
+#define NUM_LEARNERS 1
+#define SNAPSHOT_INTERVAL 10000
+#define QUEUE_SIZE 4096
+#define WEIGHT_TYPE FLOAT_WEIGHTS
+
+
+
+/* Declare a struct which is used to collect experiment results. The
+ * actors each write the entries of the games they play, so the wins are
+ * not stored as a vector<bool>, whose entries share bytes.
+ */
+struct Results
+{
+    vector<unsigned int> scores;
+    vector<unsigned char> wins;
+};
+
+
+/**
+ * This structure is a transition which an actor hands to the learners:
+ * the afterstate of a move, and what followed it. The learners train the
+ * value of the afterstate towards the reward of the next move plus the
+ * value of the next afterstate, or towards -50 if the game ended.
+ */
+struct Transition
+{
+    /* Packed board of the afterstate (see State::getBoard()) */
+    uint64_t afterState;
+
+    /* Packed board of the afterstate of the next move */
+    uint64_t nextAfterState;
+
+    /* Base 2 logarithm of the reward of the next move */
+    unsigned int reward;
+
+    /* Whether the game ended after the move, so there is no next move */
+    bool terminal;
+};
+
+
+/* Declare a struct which holds everything the actors and learners share */
+struct Pipeline
+{
+    /* Seed from which the seeds of the games are derived */
+    uint64_t seed;
+
+    /* The value function which the learners train */
+    shared_ptr<NTNN> V;
+
+    /* The latest snapshot of the value function, which the actors play
+     * with, and the number of snapshots taken so far. The snapshot is
+     * only accessed with atomic_load() and atomic_store().
+     */
+    shared_ptr<const NTNN> snapshot;
+    atomic<unsigned int> snapshotVersion;
+
+    /* Every snapshot built so far, which are reused once the actors are
+     * done with them. Only the first learner touches this list.
+     */
+    vector<shared_ptr<NTNN>> snapshots;
+
+    /* The queue of transitions of each actor */
+    vector<unique_ptr<SpscQueue<Transition>>> queues;
+
+    /* Index of the next game to be played */
+    atomic<unsigned int> nextGame;
+
+    /* Number of actors which are still playing */
+    atomic<unsigned int> activeActors;
+
+    /* Number of training updates made so far */
+    atomic<uint64_t> numUpdates;
+
+    /* Results of the games, indexed by game */
+    Results results;
+};
+
+
+/**
+ * This function builds the value function, and adds its tuples.
+ *
+ * :return: New value function
+ */
+shared_ptr<NTNN> buildNetwork()
+{
+    /* Only dense tables can be copied into snapshots */
+    shared_ptr<NTNN> V = make_shared<NTNN>(NUM_TUPLES, TUPLE_LENGTH, ALPHA, false, DENSE, WEIGHT_TYPE);
+
+    /* Add the tuples to the n-tuple regression network */
+    unsigned int tuples[NUM_TUPLES][TUPLE_LENGTH] = {
+                                                      {0, 1, 2, 3}, {4, 5, 6, 7},
+                                                      {8, 9, 10, 11}, {12, 13, 14, 15},
+                                                      {0, 4, 8, 12}, {1, 5, 9, 13},
+                                                      {2, 6, 10, 14}, {3, 7, 11, 15},
+                                                      {0, 1, 4, 5}, {1, 2, 5, 6},
+                                                      {2, 3, 6, 7}, {4, 5, 8, 9},
+                                                      {5, 6, 9, 10}, {6, 7, 10, 11},
+                                                      {8, 9, 12, 13}, {9, 10, 13, 14},
+                                                      {10, 11, 14, 15}
+                                                    };
+    for (int i = 0; i < NUM_TUPLES; ++i) {
+        V->addTuple(tuples[i], TUPLE_LENGTH);
+    }
+
+    return V;
+}
+
+
+/**
+ * This function computes the best action to take given the expansion of
+ * the current game state, and the current value function. The function
+ * chooses the action which maximizes the sum of the value of the next
+ * afterstate and the obtained reward.
+ *
+ * :param expansion: Expansion of the current game state
+ * :param V: Current value function
+ *
+ * :return: The best action to take in the current state
+ */
+Action getBestAction(const Expansion& expansion, const NTNN& V)
+{
+    Action bestAction = UP;
+    double bestValue = -numeric_limits<double>::infinity();
+    double value;
+
+    Action actions[NUM_ACTIONS];
+    State afterStates[NUM_ACTIONS];
+    double values[NUM_ACTIONS];
+    unsigned int numActions = 0;
+
+    /* Evaluate the afterstates of all of the possible actions at once */
+    for (unsigned int a = 0; a < NUM_ACTIONS; ++a) {
+        if (expansion.legalMoves & (1u << a)) {
+            actions[numActions] = static_cast<Action>(a);
+            afterStates[numActions] = expansion.afterStates[a];
+            ++numActions;
+        }
+    }
+    V.evaluate(afterStates, numActions, values);
+
+    for (unsigned int i = 0; i < numActions; ++i) {
+
+        /* Compute the value of the action, and check if
+         * the action compares favorably to previous results.
+         */
+        value = double(expansion.logRewards[actions[i]]) + values[i];
+        if (value > bestValue) {
+            bestValue = value;
+            bestAction = actions[i];
+        }
+    }
+
+    return bestAction;
+}
+
+
+/**
+ * This function copies the value function into a snapshot, and hands the
+ * snapshot to the actors. A snapshot which no actor holds any more is
+ * reused, so snapshots are only built while the actors lag behind. Only
+ * the first learner calls this function, apart from the first snapshot,
+ * which is taken before the threads start. If the weights cannot be
+ * copied, the actors keep the snapshot they have.
+ *
+ * :param pipeline: State shared by the actors and learners
+ *
+ * :return: Whether a new snapshot was handed to the actors
+ */
+bool refreshSnapshot(Pipeline& pipeline)
+{
+    shared_ptr<NTNN> snapshot;
+
+    /* A snapshot only held by the list is neither the latest one, nor
+     * held by an actor, and no actor can take hold of it again
+     */
+    for (shared_ptr<NTNN>& spare : pipeline.snapshots) {
+        if (spare.use_count() == 1) {
+            atomic_thread_fence(memory_order_acquire);
+            snapshot = spare;
+            break;
+        }
+    }
+
+    if (!snapshot) {
+        snapshot = buildNetwork();
+        pipeline.snapshots.push_back(snapshot);
+    }
+
+    if (!snapshot->copyWeights(*pipeline.V)) {
+        return false;
+    }
+
+    atomic_store(&pipeline.snapshot, shared_ptr<const NTNN>(snapshot));
+    pipeline.snapshotVersion.fetch_add(1, memory_order_release);
+    return true;
+}
+
+
+/**
+ * This function is run by each of the actor threads. The actor takes the
+ * next game which has not been played yet, and plays it with the latest
+ * snapshot of the value function, handing every transition to the
+ * learners, until all of the games are played. The actor picks up a new
+ * snapshot as soon as there is one, even in the middle of a game.
+ *
+ * :param pipeline: State shared by the actors and learners
+ * :param actor: Number of the actor, from 0 up
+ *
+ * :return: (None)
+ */
+void runActor(Pipeline& pipeline, unsigned int actor)
+{
+    SpscQueue<Transition>& queue = *pipeline.queues[actor];
+    Results& results = pipeline.results;
+
+    shared_ptr<const NTNN> V;
+    unsigned int version = 0;
+
+    for (unsigned int gameIndex = pipeline.nextGame++; gameIndex < GAMES; gameIndex = pipeline.nextGame++)
+    {
+        Game game{Rng::streamSeed(pipeline.seed, gameIndex)};
+        Expansion expansion = game.expand();
+
+        Action action = UP;
+        Transition transition;
+        bool chosen = false;
+
+        while (expansion.legalMoves != 0)
+        {
+            /* Pick up the latest snapshot, if there is a new one */
+            unsigned int latest = pipeline.snapshotVersion.load(memory_order_acquire);
+            if (!V || (latest != version)) {
+                V = atomic_load(&pipeline.snapshot);
+                version = latest;
+            }
+
+            /* Choose the move, unless it was chosen for the last transition */
+            if (!chosen) {
+                action = getBestAction(expansion, *V);
+            }
+
+            /* Execute the chosen move, and expand the next state */
+            transition.afterState = expansion.afterStates[action].getBoard();
+            game.takeAction(action, expansion);
+            expansion = game.expand();
+
+            if (expansion.legalMoves != 0) {
+                action = getBestAction(expansion, *V);
+                transition.nextAfterState = expansion.afterStates[action].getBoard();
+                transition.reward = expansion.logRewards[action];
+                transition.terminal = false;
+                chosen = true;
+            } else {
+                transition.nextAfterState = 0;
+                transition.reward = 0;
+                transition.terminal = true;
+            }
+
+            /* Wait for the learners if they are behind */
+            while (!queue.push(transition)) {
+                this_thread::yield();
+            }
+        }
+
+        /* Record the results of the current game */
+        results.scores[gameIndex] = game.getScore();
+        results.wins[gameIndex] = (game.getMaxTile() >= 2048);
+    }
+
+    pipeline.activeActors.fetch_sub(1, memory_order_release);
+}
+
+
+/**
+ * This function is run by each of the learner threads. The learner takes
+ * the transitions of its actors (every NUM_LEARNERS-th actor, starting
+ * from its own number) and trains the value function on them, until the
+ * actors are done and every transition is learned from. The first learner
+ * also refreshes the actors' snapshot every SNAPSHOT_INTERVAL updates.
+ * With several learners, they train the value function without locking
+ * it (see NTNN::train()).
+ *
+ * :param pipeline: State shared by the actors and learners
+ * :param learner: Number of the learner, from 0 up
+ *
+ * :return: (None)
+ */
+void runLearner(Pipeline& pipeline, unsigned int learner)
+{
+    NTNN& V = *pipeline.V;
+    unsigned int numActors = pipeline.queues.size();
+    uint64_t lastSnapshot = 0;
+    Transition transition;
+    double valueUpdate;
+
+    while (true) {
+
+        /* Once every actor is done, the learner is done as soon as it
+         * finds all of its queues empty
+         */
+        bool finishing = (pipeline.activeActors.load(memory_order_acquire) == 0);
+        bool idle = true;
+
+        for (unsigned int actor = learner; actor < numActors; actor += NUM_LEARNERS) {
+            SpscQueue<Transition>& queue = *pipeline.queues[actor];
+
+            for (unsigned int i = 0; (i < QUEUE_SIZE) && queue.pop(transition); ++i) {
+                if (transition.terminal) {
+                    valueUpdate = -50.0;
+                } else {
+                    valueUpdate = double(transition.reward);
+                    valueUpdate += V.evaluate(State{transition.nextAfterState});
+                }
+                V.train(State{transition.afterState}, valueUpdate);
+                idle = false;
+
+                uint64_t numUpdates = ++pipeline.numUpdates;
+                if ((learner == 0) && (numUpdates - lastSnapshot >= SNAPSHOT_INTERVAL)) {
+                    refreshSnapshot(pipeline);
+                    lastSnapshot = numUpdates;
+                }
+            }
+        }
+
+        if (idle) {
+            if (finishing) {
+                break;
+            }
+            this_thread::yield();
+        }
+    }
+}
+
+
+/**
+ * This is the function which runs the program. In this program, we train
+ * an agent to play the game 2048 using Temporal Difference learning
+ * applied to the game's afterstates, with the game playing split from the
+ * learning. Actor threads play games with a snapshot of the agent, and
+ * learner threads train the agent on the moves the actors make.
+ *
+ * :param argc: Number of command line arguments
+ * :param argv: Command line arguments
+ *
+ * :return: Error code (0 = no error)
+ */
+int main(int argc, char **argv)
+{
+    /* Every game's seed is derived from this master seed, so printing
+     * it lets us reproduce the experiment later on.
+     */
+    uint64_t masterSeed = time(NULL);
+
+    unsigned int numActors = NUM_ACTORS;
+    if (numActors == 0) {
+        unsigned int numCores = thread::hardware_concurrency();
+        numActors = (numCores > NUM_LEARNERS) ? numCores - NUM_LEARNERS : 1;
+    }
+
+    cout << "Learning Rate: " << ALPHA << endl;
+    cout << "Number of Games: " << GAMES << endl;
+    cout << "Actors: " << numActors << "; Learners: " << NUM_LEARNERS << endl;
+    cout << "Seed: " << masterSeed << endl;
+
+    Pipeline pipeline;
+    pipeline.seed = masterSeed;
+    pipeline.V = buildNetwork();
+    cout << "Value function memory: " << double(pipeline.V->getMemoryBudget()) / (1024*1024) << " MB" << endl;
+    pipeline.snapshotVersion = 0;
+    pipeline.nextGame = 0;
+    pipeline.activeActors = numActors;
+    pipeline.numUpdates = 0;
+    pipeline.results.scores.assign(GAMES, 0);
+    pipeline.results.wins.assign(GAMES, 0);
+
+    for (unsigned int actor = 0; actor < numActors; ++actor) {
+        pipeline.queues.emplace_back(new SpscQueue<Transition>(QUEUE_SIZE));
+    }
+
+    /* The actors start out with a snapshot of the new agent */
+    if (!refreshSnapshot(pipeline)) {
+        cout << "Could not take a snapshot of the value function" << endl;
+        return 1;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    vector<thread> threads;
+    for (unsigned int learner = 0; learner < NUM_LEARNERS; ++learner) {
+        threads.emplace_back(runLearner, ref(pipeline), learner);
+    }
+    for (unsigned int actor = 0; actor < numActors; ++actor) {
+        threads.emplace_back(runActor, ref(pipeline), actor);
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    const Results& results = pipeline.results;
+
+    /* Summarize the run: its speed, and the mean score of the first and
+     * last tenth of the games
+     */
+    double firstScore = 0.0;
+    double lastScore = 0.0;
+    for (unsigned int i = 0; i < GAMES / 10; ++i) {
+        firstScore += results.scores[i];
+        lastScore += results.scores[GAMES - 1 - i];
+    }
+
+    cout << "Games/s: " << GAMES / seconds;
+    cout << "; Updates: " << pipeline.numUpdates.load();
+    cout << "; Snapshots: " << pipeline.snapshotVersion.load() << endl;
+    cout << "Mean score of the first tenth of the games: " << firstScore / (GAMES / 10) << endl;
+    cout << "Mean score of the last tenth of the games: " << lastScore / (GAMES / 10) << endl;
+
+    /* Create the names of the results files */
+    ostringstream scoresFileName;
+    scoresFileName << "results/";
+    scoresFileName << "TD_AL_" << GAMES << "_" << int(1000*ALPHA) << "_scores.csv";
+
+    ostringstream winsFileName;
+    winsFileName << "results/";
+    winsFileName << "TD_AL_" << GAMES << "_" << int(1000*ALPHA) << "_wins.csv";
+
+    /* Save the data to a csv file in the results folder */
+    fstream scoresFile;
+    fstream winsFile;
+    scoresFile.open(scoresFileName.str(), ios::out | ios::app);
+    winsFile.open(winsFileName.str(), ios::out | ios::app);
+
+    for (unsigned int i = 0; i < GAMES; ++i) {
+
+        scoresFile << results.scores[i];
+        winsFile << int(results.wins[i]);
+
+        if (i != GAMES-1) {
+            scoresFile << ", ";
+            winsFile << ", ";
+        }
+    }
+
+    scoresFile << '\n';
+    winsFile << '\n';
+
+    scoresFile.close();
+    winsFile.close();
+
+    return 0;
+}
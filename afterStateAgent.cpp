@@ -10,14 +10,15 @@
 #include <string>
 #include <limits>
 #include <vector>
+#include <utility>
 #include <stdlib.h>
 #include <time.h>
-#include <cmath>
 #include <unistd.h>
 
 #include "state.hpp"
 #include "game.hpp"
 #include "ntnn.hpp"
+#include "checkpointer.hpp"
 
 using namespace std;
 
@@ -31,74 +32,92 @@ using namespace std;
  * SHOW_GAME: Whether or not the you can see the agent play the game
  * NEW_AGENT: Do you want to start a new agent from scratch (true), or load
  *            an existing agent from disk (false)?
- * AGENT_FILE: The file in which you wish to save the agent's value function
+ * AGENT_FILE: The binary file in which you wish to save the agent's value
+ *             function (see NTNN::saveBinary()). Use convertAgent to turn
+ *             an agent saved in the old CSV format into such a file.
  * SCORES_FILE: The file in which you wish to save the agent's game scores
  * WINS_FILE: The file in which you wish to save the agent's game wins
  * SAVE_INTERVAL: How many games must pass before the agent, as well as the 
- *                scores and wins, are saved to disk?
+ *                scores and wins, are saved to disk? The agent is saved in
+ *                the background, so training only pauses to copy it. Most
+ *                saves only write the weights which changed since the last
+ *                one, as a delta file next to AGENT_FILE.
+ * COMPACT_INTERVAL: Every how many saves is the whole agent written to
+ *                   AGENT_FILE, replacing the delta files? Loading an agent
+ *                   applies the delta files, so this only bounds how many
+ *                   of them pile up.
+ * WEIGHT_TYPE: Type of the value function's weights. FLOAT_WEIGHTS halves
+ *              the memory of DOUBLE_WEIGHTS and is fine for training, while
+ *              FIXED16_WEIGHTS quarters it but is only fit for playing
+ *              (set ALPHA to 0), as it rounds away small updates. AGENT_FILE
+ *              must hold weights of this type; convertAgent turns a trained
+ *              agent into one with fixed-point weights.
  */
 #define GAMES 10000000
 #define ALPHA 0.0001
 #define SHOW_GAME false
 #define NEW_AGENT false
-#define AGENT_FILE "agents/TD_AS_AGENT.csv"
+#define AGENT_FILE "agents/TD_AS_AGENT.bin"
 #define SCORES_FILE "results/TD_AS_0_0_scores.csv"
 #define WINS_FILE "results/TD_AS_0_0_wins.csv"
 #define SAVE_INTERVAL 1000
+#define COMPACT_INTERVAL 10
+#define WEIGHT_TYPE FLOAT_WEIGHTS
 
 /**
- * This function computes the best action to take given the current game
- * state, an array of possible actions, and the current value function. 
- * The function chooses the action which maximizes the sum of the value 
- * of the next afterstate and the obtained reward.
+ * This function computes the best action to take given the expansion of
+ * the current game state, and the current value function. The function 
+ * chooses the action which maximizes the sum of the value of the next 
+ * afterstate and the obtained reward.
  *
- * :param state: Reference to the current state
- * :param actions: Array of available actions in the current state
- * :param numActions: Number of actions in the actions array
+ * The afterstates of the possible actions are evaluated into evaluations,
+ * with the evaluation of the best action's afterstate moved to the front,
+ * so that the network can later be trained on it without evaluating it
+ * again.
+ *
+ * :param expansion: Expansion of the current game state
  * :param V: Current value function
+ * :param evaluations: Array of NUM_ACTIONS evaluations, the first of which
+ *                     holds the best action's afterstate (return value)
  *
  * :return: The best action to take in the current state
  */
-Action getBestAction(const State& state, Action* actions, int numActions, const NTNN& V)
+Action getBestAction(const Expansion& expansion, const NTNN& V, Evaluation* evaluations)
 {
-    Action bestAction;
-    Action a;
+    Action bestAction = UP;
     double bestValue = -numeric_limits<double>::infinity();
-
-    unsigned int reward;
     double value;
 
-    for (int i = 0; i < numActions; ++i) {
-        
-        a = actions[i];
-        State afterState{state};
-
-        /* Compute the afterstate based on the action */
-        if (a == UP) {
-            reward = afterState.slideUp();
-        } else if (a == DOWN) {
-            reward = afterState.slideDown();
-        } else if (a == LEFT) {
-            reward = afterState.slideLeft();
-        } else {
-            reward = afterState.slideRight();
+    Action actions[NUM_ACTIONS];
+    State afterStates[NUM_ACTIONS];
+    unsigned int numActions = 0;
+    unsigned int best = 0;
+
+    /* Evaluate the afterstates of all of the possible actions at once */
+    for (unsigned int a = 0; a < NUM_ACTIONS; ++a) {
+        if (expansion.legalMoves & (1u << a)) {
+            actions[numActions] = static_cast<Action>(a);
+            afterStates[numActions] = expansion.afterStates[a];
+            ++numActions;
         }
+    }
+    V.evaluate(afterStates, numActions, evaluations);
 
-        if (reward != 0)
-        {
-            reward = log2(reward);
-        }
+    for (unsigned int i = 0; i < numActions; ++i) {
 
         /* Compute the value of the action, and check if 
          * the action compares favorably to previous results.
          */
-        value = double(reward) + V.evaluate(afterState);
+        value = double(expansion.logRewards[actions[i]]) + evaluations[i].value;
         if (value > bestValue) {
             bestValue = value;
-            bestAction = a;
+            bestAction = actions[i];
+            best = i;
         }
     }
 
+    swap(evaluations[0], evaluations[best]);
+
     return bestAction;
 }
 
@@ -139,21 +158,23 @@ void saveScores(unsigned int* scores, bool* wins)
  * the 2048 game afterstates. The scores and outcomes of the games which
  * the algorithms played are stored in the given, pre-allocated arrays.
  *
+ * :param showGame: Whether or not to show the agent playing each game
+ * :param seed: Seed from which the seeds of the games are derived
+ *
  * :return: (None)
  */
-void playGame(bool showGame)
+void playGame(bool showGame, uint64_t seed)
 {
     /* Declare the value function */
-    NTNN V(NUM_TUPLES, TUPLE_LENGTH, ALPHA);
+    NTNN V(NUM_TUPLES, TUPLE_LENGTH, ALPHA, false, DENSE, WEIGHT_TYPE);
+
+    /* Declare the checkpointer which saves the value function to disk */
+    Checkpointer checkpointer;
 
     /* Declare the arrays to hold the scores and wins */
     unsigned int scores[SAVE_INTERVAL];
     bool wins[SAVE_INTERVAL];
 
-    if (!NEW_AGENT) {
-        V.load(AGENT_FILE);
-    }
-
     /* Add the tuples to the n-tuple regression network */
     unsigned int tuples[NUM_TUPLES][TUPLE_LENGTH] = {
                                                       {0, 1, 2, 3}, {4, 5, 6, 7}, 
@@ -170,54 +191,56 @@ void playGame(bool showGame)
         V.addTuple(tuples[i], TUPLE_LENGTH);
     }
 
-    
-    Action actions[4];
-    unsigned int numActions;
-    
+    cout << "Value function memory: " << double(V.getMemoryBudget()) / (1024*1024) << " MB" << endl;
+
+    /* The agent file can only be loaded once the network has its tuples */
+    if (!NEW_AGENT && !V.loadBinary(AGENT_FILE)) {
+        cout << "Could not load " << AGENT_FILE << ", starting a new agent" << endl;
+    }
+
+
+    /* Evaluations of the afterstates, kept from game to game so that
+     * their indices are only allocated once
+     */
+    Evaluation evaluations[NUM_ACTIONS];
+    Evaluation afterState;
+
+    /* Number of times the agent was saved, the first of which is a full save */
+    unsigned int numSaves = 0;
+
     for (unsigned int gameIndex = 0; gameIndex < GAMES; ++gameIndex)
     {
-        Game game;
-        numActions = game.getActions(actions);
+        Game game{Rng::streamSeed(seed, gameIndex)};
+        Expansion expansion = game.expand();
 
-        State state;
-        State afterState;
-        State nextState;
-        State nextAfterState;
         Action bestAction;
         Action nextBestAction;
-        unsigned int reward;
-        unsigned int rNext;
         double valueUpdate;
 
-        while (numActions > 0)
+        while (expansion.legalMoves != 0)
         {
-            /* Get the current state of the game. If desired, show the game
-             * as the agent plays, including current score.
+            /* If desired, show the game as the agent plays, 
+             * including current score.
              */
-            state = game.getState();
-
             if (showGame) {
-                state.print();
+                game.getState().print();
                 cout << "Current Score: " << game.getScore() << endl;
                 usleep(250000);
             }
 
-            bestAction = getBestAction(state, actions, numActions, V);
-            reward = game.takeAction(bestAction, afterState);
-            nextState = game.getState();
-            numActions = game.getActions(actions);
+            bestAction = getBestAction(expansion, V, evaluations);
+            swap(afterState, evaluations[0]);
 
-            /* Start the learning part of the algorithm */
-            if (numActions > 0) {
-                nextBestAction = getBestAction(nextState, actions, numActions, V);
-                rNext = game.pretendTakeAction(nextBestAction, nextAfterState);
+            /* Execute the chosen move, and expand the next state */
+            game.takeAction(bestAction, expansion);
+            expansion = game.expand();
 
-                if (rNext != 0)
-                {
-                    rNext = log2(rNext);
-                }
+            /* Start the learning part of the algorithm */
+            if (expansion.legalMoves != 0) {
+                nextBestAction = getBestAction(expansion, V, evaluations);
 
-                valueUpdate = double(rNext) + V.evaluate(nextAfterState);
+                valueUpdate = double(expansion.logRewards[nextBestAction]);
+                valueUpdate += evaluations[0].value;
                 V.train(afterState, valueUpdate);
                 
             } else if (game.getScore() < 25000) {
@@ -242,7 +265,14 @@ void playGame(bool showGame)
         if ((gameIndex % SAVE_INTERVAL == 0) && (gameIndex > 0)) 
         {
             saveScores(scores, wins);
-            V.save(AGENT_FILE);
+
+            /* Write a delta, unless it is time to compact the deltas */
+            if (numSaves % COMPACT_INTERVAL == 0) {
+                checkpointer.save(V, AGENT_FILE);
+            } else {
+                checkpointer.saveDelta(V, AGENT_FILE);
+            }
+            ++numSaves;
         }
 
         /* Save the current game's score */
@@ -252,6 +282,11 @@ void playGame(bool showGame)
 
     /* Move the cursor to the next line */
     cout << endl;
+
+    /* Make sure the last checkpoint made it to disk */
+    if (!checkpointer.wait()) {
+        cout << "Could not save " << AGENT_FILE << endl;
+    }
 }
 
 
@@ -269,16 +304,19 @@ void playGame(bool showGame)
  */
 int main(int argc, char **argv)
 {
-    /* Initialize the random seed */
-    srand(time(NULL));
+    /* Every game's seed is derived from this master seed, so printing
+     * it lets us reproduce the experiment later on.
+     */
+    uint64_t masterSeed = time(NULL);
 
     cout << "Learning Rate: " << ALPHA << endl;
     cout << "Number of Games per Experiment: " << GAMES << endl;
+    cout << "Seed: " << masterSeed << endl;
 
     /* Train the agent using temporal difference learning applied to 
      * game afterstates. As we go, save the agent to disk.
      */
-    playGame(SHOW_GAME);
+    playGame(SHOW_GAME, masterSeed);
 
     return 0;
 }
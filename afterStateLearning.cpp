@@ -10,9 +10,9 @@
 #include <string>
 #include <limits>
 #include <vector>
+#include <utility>
 #include <stdlib.h>
 #include <time.h>
-#include <cmath>
 
 #include "state.hpp"
 #include "game.hpp"
@@ -43,58 +43,59 @@ struct Results
 
 
 /**
- * This function computes the best action to take given the current game
- * state, an array of possible actions, and the current value function. 
- * The function chooses the action which maximizes the sum of the value 
- * of the next afterstate and the obtained reward.
+ * This function computes the best action to take given the expansion of
+ * the current game state, and the current value function. The function 
+ * chooses the action which maximizes the sum of the value of the next 
+ * afterstate and the obtained reward.
  *
- * :param state: Reference to the current state
- * :param actions: Array of available actions in the current state
- * :param numActions: Number of actions in the actions array
+ * The afterstates of the possible actions are evaluated into evaluations,
+ * with the evaluation of the best action's afterstate moved to the front,
+ * so that the network can later be trained on it without evaluating it
+ * again.
+ *
+ * :param expansion: Expansion of the current game state
  * :param V: Current value function
+ * :param evaluations: Array of NUM_ACTIONS evaluations, the first of which
+ *                     holds the best action's afterstate (return value)
  *
  * :return: The best action to take in the current state
  */
-Action getBestAction(const State& state, Action* actions, int numActions, const NTNN& V)
+Action getBestAction(const Expansion& expansion, const NTNN& V, Evaluation* evaluations)
 {
-    Action bestAction;
-    Action a;
+    Action bestAction = UP;
     double bestValue = -numeric_limits<double>::infinity();
-
-    unsigned int reward;
     double value;
 
-    for (int i = 0; i < numActions; ++i) {
-        
-        a = actions[i];
-        State afterState{state};
-
-        /* Compute the afterstate based on the action */
-        if (a == UP) {
-            reward = afterState.slideUp();
-        } else if (a == DOWN) {
-            reward = afterState.slideDown();
-        } else if (a == LEFT) {
-            reward = afterState.slideLeft();
-        } else {
-            reward = afterState.slideRight();
+    Action actions[NUM_ACTIONS];
+    State afterStates[NUM_ACTIONS];
+    unsigned int numActions = 0;
+    unsigned int best = 0;
+
+    /* Evaluate the afterstates of all of the possible actions at once */
+    for (unsigned int a = 0; a < NUM_ACTIONS; ++a) {
+        if (expansion.legalMoves & (1u << a)) {
+            actions[numActions] = static_cast<Action>(a);
+            afterStates[numActions] = expansion.afterStates[a];
+            ++numActions;
         }
+    }
+    V.evaluate(afterStates, numActions, evaluations);
 
-        if (reward != 0)
-        {
-            reward = log2(reward);
-        }
+    for (unsigned int i = 0; i < numActions; ++i) {
 
         /* Compute the value of the action, and check if 
          * the action compares favorably to previous results.
          */
-        value = double(reward) + V.evaluate(afterState);
+        value = double(expansion.logRewards[actions[i]]) + evaluations[i].value;
         if (value > bestValue) {
             bestValue = value;
-            bestAction = a;
+            bestAction = actions[i];
+            best = i;
         }
     }
 
+    swap(evaluations[0], evaluations[best]);
+
     return bestAction;
 }
 
@@ -104,10 +105,12 @@ Action getBestAction(const State& state, Action* actions, int numActions, const
  * the 2048 game afterstates. The scores and outcomes of the games which
  * the algorithms played are stored in the given, pre-allocated arrays.
  *
+ * :param seed: Seed from which the seeds of the games are derived
+ *
  * :return: The results of the experiment (wins and scores as a function of
  *          number of games played)
  */
-Results afterStateLearning()
+Results afterStateLearning(uint64_t seed)
 {
     /* Create the struct to store the experiment results */
     Results results;
@@ -131,45 +134,37 @@ Results afterStateLearning()
         V.addTuple(tuples[i], TUPLE_LENGTH);
     }
 
-    
-    Action actions[4];
-    unsigned int numActions;
-    
+
+    /* Evaluations of the afterstates, kept from game to game so that
+     * their indices are only allocated once
+     */
+    Evaluation evaluations[NUM_ACTIONS];
+    Evaluation afterState;
+
     for (unsigned int gameIndex = 0; gameIndex < GAMES; ++gameIndex)
     {
-        Game game;
-        numActions = game.getActions(actions);
+        Game game{Rng::streamSeed(seed, gameIndex)};
+        Expansion expansion = game.expand();
 
-        State state;
-        State afterState;
-        State nextState;
-        State nextAfterState;
         Action bestAction;
         Action nextBestAction;
-        unsigned int reward;
-        unsigned int rNext;
         double valueUpdate;
 
-        while (numActions > 0)
+        while (expansion.legalMoves != 0)
         {
-            state = game.getState();
-            bestAction = getBestAction(state, actions, numActions, V);
+            bestAction = getBestAction(expansion, V, evaluations);
+            swap(afterState, evaluations[0]);
 
-            reward = game.takeAction(bestAction, afterState);
-            nextState = game.getState();
-            numActions = game.getActions(actions);
+            /* Execute the chosen move, and expand the next state */
+            game.takeAction(bestAction, expansion);
+            expansion = game.expand();
 
             /* Start the learning part of the algorithm */
-            if (numActions > 0) {
-                nextBestAction = getBestAction(nextState, actions, numActions, V);
-                rNext = game.pretendTakeAction(nextBestAction, nextAfterState);
-
-                if (rNext != 0)
-                {
-                    rNext = log2(rNext);
-                }
+            if (expansion.legalMoves != 0) {
+                nextBestAction = getBestAction(expansion, V, evaluations);
 
-                valueUpdate = double(rNext) + V.evaluate(nextAfterState);
+                valueUpdate = double(expansion.logRewards[nextBestAction]);
+                valueUpdate += evaluations[0].value;
                 V.train(afterState, valueUpdate);
                 
             } else {
@@ -213,11 +208,14 @@ Results afterStateLearning()
  */
 int main(int argc, char **argv)
 {
-    /* Initialize the random seed */
-    srand(time(NULL));
+    /* Every game's seed is derived from this master seed, so printing
+     * it lets us reproduce the experiment later on.
+     */
+    uint64_t masterSeed = time(NULL);
 
     cout << "Learning Rate: " << ALPHA << endl;
     cout << "Number of Games per Experiment: " << GAMES << endl;
+    cout << "Seed: " << masterSeed << endl;
 
     for (int experiment = 1; experiment <= NUM_EXPERIMENTS; ++experiment)
     {
@@ -225,7 +223,7 @@ int main(int argc, char **argv)
         cout << "Experiment " << experiment << " / " << NUM_EXPERIMENTS << endl;
 
         /* Collect the results from each of the experiments */
-        Results experimentResults = afterStateLearning();
+        Results experimentResults = afterStateLearning(Rng::streamSeed(masterSeed, experiment));
 
         /* Create the names of the results files */
         ostringstream scoresFileName;
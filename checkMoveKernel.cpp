@@ -0,0 +1,122 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include <iostream>
+#include <vector>
+
+#include "movekernel.hpp"
+#include "rng.hpp"
+
+using namespace std;
+
+/* These values are the parameters of the check.
+ * NUM_BOARDS: The number of random boards to expand, which is not a
+ *             multiple of the vector width, so the kernels' tails are run
+ * SEED: The seed from which the random boards are drawn
+ */
+#define NUM_BOARDS 1000003
+#define SEED 2048
+
+/* The kernels to compare against the scalar one */
+static const char* KERNELS[] = {"sse4.1", "avx2"};
+
+
+/**
+ * This function draws a random packed board. The tiles of a board are
+ * drawn from a small, medium or full range of values in turn, so that
+ * there are boards with many merges as well as boards with no legal
+ * move in some directions.
+ *
+ * :param rng: Random number generator to draw the board with
+ * :param i: Index of the board
+ *
+ * :return: Random packed board
+ */
+uint64_t randomBoard(Rng& rng, unsigned int i)
+{
+    static const unsigned int RANGES[] = {3, 6, 16};
+    unsigned int range = RANGES[i % 3];
+    uint64_t board = 0;
+
+    for (unsigned int cell = 0; cell < 16; ++cell) {
+        board |= uint64_t(rng.nextBelow(range)) << (4*cell);
+    }
+
+    return board;
+}
+
+
+/**
+ * This function is the main function which runs this program. In this
+ * program, random boards are expanded with every move kernel the CPU
+ * supports, and the results of the SIMD kernels are compared with those
+ * of the scalar kernel. A kernel which the CPU does not support is
+ * skipped.
+ *
+ * :param argc: Number of input arguments
+ * :param argv: Command line arguments
+ *
+ * :return: Error code (1 if any kernel disagrees with the scalar one)
+ */
+int main(int argc, char **argv)
+{
+    Rng rng{SEED};
+
+    vector<uint64_t> boards(NUM_BOARDS);
+    for (unsigned int i = 0; i < NUM_BOARDS; ++i) {
+        boards[i] = randomBoard(rng, i);
+    }
+
+    /* Expand the boards with the scalar kernel, as the reference */
+    vector<uint64_t> afterStates(4*NUM_BOARDS);
+    vector<unsigned int> rewards(4*NUM_BOARDS);
+    vector<unsigned char> legalMoves(NUM_BOARDS);
+    expandBoardsWith("scalar", boards.data(), NUM_BOARDS, afterStates.data(),
+                     rewards.data(), legalMoves.data());
+
+    int errorCode = 0;
+
+    for (const char* kernel : KERNELS) {
+
+        vector<uint64_t> kernelAfterStates(4*NUM_BOARDS);
+        vector<unsigned int> kernelRewards(4*NUM_BOARDS);
+        vector<unsigned char> kernelLegalMoves(NUM_BOARDS);
+
+        if (!expandBoardsWith(kernel, boards.data(), NUM_BOARDS, kernelAfterStates.data(),
+                              kernelRewards.data(), kernelLegalMoves.data())) {
+            cout << kernel << ": not supported by this CPU, skipped" << endl;
+            continue;
+        }
+
+        /* Count the boards on which the kernel disagrees */
+        unsigned int mismatches = 0;
+        for (unsigned int i = 0; i < NUM_BOARDS; ++i) {
+            bool same = (kernelLegalMoves[i] == legalMoves[i]);
+            for (unsigned int a = 0; a < 4; ++a) {
+                same = same && (kernelAfterStates[4*i + a] == afterStates[4*i + a]);
+                same = same && (kernelRewards[4*i + a] == rewards[4*i + a]);
+            }
+
+            if (!same) {
+                if (mismatches == 0) {
+                    cout << kernel << ": first mismatch on board " << hex << boards[i]
+                         << dec << endl;
+                }
+                ++mismatches;
+            }
+        }
+
+        if (mismatches > 0) {
+            cout << kernel << ": " << mismatches << " of " << NUM_BOARDS
+                 << " boards differ from the scalar kernel" << endl;
+            errorCode = 1;
+        } else {
+            cout << kernel << ": all " << NUM_BOARDS << " boards match the scalar kernel" << endl;
+        }
+    }
+
+    return errorCode;
+}
@@ -0,0 +1,189 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "state.hpp"
+#include "ntnn.hpp"
+#include "rng.hpp"
+
+using namespace std;
+
+/* These values are the parameters of the check.
+ * NUM_STATES: The number of random states to evaluate, which is not a
+ *             multiple of the batch size, so the last batch is partial
+ * NUM_TUPLES: The number of tuples in each network
+ * ALPHA: The learning rate used to give the weights random values
+ * TOLERANCE: The relative difference allowed between the kernels' values,
+ *            which only comes from adding up the weights in another order
+ * SEED: The seed from which the random states and values are drawn
+ */
+#define NUM_STATES 4099
+#define NUM_TUPLES 3
+#define ALPHA 0.1
+#define TOLERANCE 1e-9
+#define SEED 2048
+
+/* The weight types the gather kernel supports */
+static const WeightType WEIGHT_TYPES[] = {DOUBLE_WEIGHTS, FLOAT_WEIGHTS, FIXED32_WEIGHTS};
+static const char* WEIGHT_NAMES[] = {"double", "float", "fixed32"};
+
+/* The tuples of the networks, by length */
+static unsigned int TUPLES_4[NUM_TUPLES][4] = {{0, 1, 2, 3}, {0, 4, 8, 12}, {0, 1, 4, 5}};
+static unsigned int TUPLES_6[NUM_TUPLES][6] = {{0, 1, 2, 3, 4, 5}, {4, 5, 6, 7, 8, 9},
+                                               {0, 1, 2, 4, 5, 6}};
+
+
+/**
+ * This function draws a random state. The tiles of a state are drawn
+ * from a small or full range of values in turn.
+ *
+ * :param rng: Random number generator to draw the state with
+ * :param i: Index of the state
+ *
+ * :return: Random state
+ */
+State randomState(Rng& rng, unsigned int i)
+{
+    unsigned int range = (i % 2 == 0) ? 6 : 16;
+    uint64_t board = 0;
+
+    for (unsigned int cell = 0; cell < 16; ++cell) {
+        board |= uint64_t(rng.nextBelow(range)) << (4*cell);
+    }
+
+    return State{board};
+}
+
+
+/**
+ * Checks whether two values of a state agree within TOLERANCE.
+ */
+bool closeValues(double a, double b)
+{
+    return fabs(a - b) <= TOLERANCE*(1.0 + fabs(b));
+}
+
+
+/**
+ * This function builds a network, gives its weights random values by
+ * training it on the states, and evaluates the states with the gather
+ * kernel and the scalar kernel, through both the single-state and the
+ * batched evaluate().
+ *
+ * :param type: Index of the weight type to check (see WEIGHT_TYPES)
+ * :param length: Length of the tuples, 4 or 6
+ * :param symmetric: Whether the tuples are added with addSymmetricTuple()
+ * :param states: States to evaluate
+ * :param rng: Random number generator for the training values
+ *
+ * :return: Whether the kernels agree (true if the network has no gather kernel)
+ */
+bool checkNetwork(unsigned int type, unsigned int length, bool symmetric,
+                  const vector<State>& states, Rng& rng)
+{
+    NTNN V(NUM_TUPLES, length, ALPHA, true, DENSE, WEIGHT_TYPES[type]);
+
+    for (unsigned int i = 0; i < NUM_TUPLES; ++i) {
+        unsigned int* tuple = (length == 4) ? TUPLES_4[i] : TUPLES_6[i];
+        if (symmetric) {
+            V.addSymmetricTuple(tuple, length);
+        } else {
+            V.addTuple(tuple, length);
+        }
+    }
+
+    cout << WEIGHT_NAMES[type] << ", " << length << "-tuples, "
+         << (symmetric ? "symmetric" : "plain") << ": ";
+
+    if (!V.setEvaluateKernel("avx2")) {
+        cout << "no gather kernel on this CPU, skipped" << endl;
+        return true;
+    }
+
+    for (const State& state : states) {
+        V.train(state, 100.0*rng.nextDouble());
+    }
+
+    /* Evaluate the states with each kernel in turn */
+    unsigned int count = states.size();
+    vector<double> gatherValues(count), scalarValues(count);
+    vector<double> gatherSingle(count), scalarSingle(count);
+    vector<Evaluation> gatherEvaluations(count), scalarEvaluations(count);
+
+    V.evaluate(states.data(), count, gatherValues.data());
+    V.evaluate(states.data(), count, gatherEvaluations.data());
+    for (unsigned int k = 0; k < count; ++k) {
+        gatherSingle[k] = V.evaluate(states[k]);
+    }
+
+    V.setEvaluateKernel("scalar");
+    V.evaluate(states.data(), count, scalarValues.data());
+    V.evaluate(states.data(), count, scalarEvaluations.data());
+    for (unsigned int k = 0; k < count; ++k) {
+        scalarSingle[k] = V.evaluate(states[k]);
+    }
+
+    /* Count the states on which the kernels disagree */
+    unsigned int mismatches = 0;
+    for (unsigned int k = 0; k < count; ++k) {
+        bool same = closeValues(gatherValues[k], scalarValues[k]) &&
+                    closeValues(gatherSingle[k], scalarSingle[k]) &&
+                    closeValues(gatherEvaluations[k].value, scalarEvaluations[k].value) &&
+                    closeValues(gatherValues[k], scalarSingle[k]) &&
+                    (gatherEvaluations[k].indices == scalarEvaluations[k].indices);
+        if (!same) {
+            ++mismatches;
+        }
+    }
+
+    if (mismatches > 0) {
+        cout << mismatches << " of " << count << " states differ between the kernels" << endl;
+        return false;
+    }
+
+    cout << "all " << count << " states match" << endl;
+    return true;
+}
+
+
+/**
+ * This function is the main function which runs this program. In this
+ * program, networks with each weight type the gather kernel supports,
+ * with 4- and 6-tuples, plain and symmetric, evaluate random states
+ * with the AVX2 gather kernel and with the scalar kernel, and the values
+ * and weight indices of the two kernels are compared.
+ *
+ * :param argc: Number of input arguments
+ * :param argv: Command line arguments
+ *
+ * :return: Error code (1 if the kernels disagree on any network)
+ */
+int main(int argc, char **argv)
+{
+    Rng rng{SEED};
+
+    vector<State> states;
+    for (unsigned int i = 0; i < NUM_STATES; ++i) {
+        states.push_back(randomState(rng, i));
+    }
+
+    int errorCode = 0;
+
+    for (unsigned int type = 0; type < 3; ++type) {
+        for (unsigned int length = 4; length <= 6; length += 2) {
+            for (bool symmetric : {false, true}) {
+                if (!checkNetwork(type, length, symmetric, states, rng)) {
+                    errorCode = 1;
+                }
+            }
+        }
+    }
+
+    return errorCode;
+}
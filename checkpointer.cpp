@@ -0,0 +1,82 @@
+/** 
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include "checkpointer.hpp"
+
+#include <utility>
+
+using namespace std;
+
+
+Checkpointer::Checkpointer()
+    : writer(&Checkpointer::run, this)
+{
+}
+
+
+Checkpointer::~Checkpointer()
+{
+    {
+        lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+}
+
+
+bool Checkpointer::wait()
+{
+    unique_lock<std::mutex> lock(stateMutex);
+    changed.wait(lock, [this] { return !hasPending && !busy; });
+
+    bool saved = succeeded;
+    succeeded = true;
+    return saved;
+}
+
+
+bool Checkpointer::post(unique_lock<std::mutex>& lock, const string& agentFile)
+{
+    pendingFile = agentFile;
+    hasPending = true;
+    lock.unlock();
+
+    changed.notify_all();
+    return true;
+}
+
+
+void Checkpointer::run()
+{
+    unique_lock<std::mutex> lock(stateMutex);
+
+    while (true) {
+        changed.wait(lock, [this] { return hasPending || stopping; });
+
+        /* Only stop once the last checkpoint is saved */
+        if (!hasPending) {
+            break;
+        }
+
+        /* Take the waiting snapshot, so that the next one can be copied
+         * while this one is written.
+         */
+        swap(writing, pending);
+        string agentFile = pendingFile;
+        hasPending = false;
+        busy = true;
+        changed.notify_all();
+
+        lock.unlock();
+        bool saved = writing->save(agentFile);
+        lock.lock();
+
+        succeeded = succeeded && saved;
+        busy = false;
+        changed.notify_all();
+    }
+}
@@ -0,0 +1,158 @@
+/** 
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#ifndef CHECKPOINTER_H
+#define CHECKPOINTER_H 1
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "ntnn.hpp"
+
+
+/**
+ * Class which saves checkpoints of a network on a background thread, so
+ * that training only stops for as long as it takes to copy the network's
+ * tables (see NTNN::snapshot()). The copy is then written to a binary 
+ * agent file by the checkpointer's writer thread, under a temporary name
+ * which is renamed into place once the file is complete.
+ *
+ * The checkpointer holds two snapshots: the one being written, and the
+ * latest one waiting to be written. If checkpoints come faster than they
+ * can be written, a waiting checkpoint is replaced by the newer one, so 
+ * training never waits for the disk.
+ *
+ * A delta checkpoint (see NTNN::saveDelta()) only copies and writes the 
+ * parts of the tables which changed since the last checkpoint, so it is
+ * much cheaper. Deltas cannot be dropped, as each one builds on the one
+ * before, so a delta waits for the writer to take any waiting checkpoint
+ * instead of replacing it. If a delta cannot be saved, the deltas after 
+ * it are not loaded either, until the next full checkpoint.
+ */
+class Checkpointer
+{
+
+private:
+
+    /* The two snapshots, which swap roles as the writer takes one */
+    WeightSnapshot snapshots[2];
+
+    /* Snapshot which the writer thread is saving */
+    WeightSnapshot* writing = &snapshots[0];
+
+    /* Latest snapshot, waiting to be saved, and the file it goes to */
+    WeightSnapshot* pending = &snapshots[1];
+    std::string pendingFile;
+    bool hasPending = false;
+
+    /* Whether the writer thread is saving a snapshot */
+    bool busy = false;
+
+    /* Whether every checkpoint since the last wait() was saved */
+    bool succeeded = true;
+
+    /* Whether the writer thread should finish up and exit */
+    bool stopping = false;
+
+    /* Guards the members above, and signals changes to them */
+    std::mutex stateMutex;
+    std::condition_variable changed;
+
+    /* Thread which saves the snapshots */
+    std::thread writer;
+
+public:
+
+    /**
+     * The constructor for a Checkpointer object, which starts its writer
+     * thread.
+     *
+     * :return: New Checkpointer object
+     */
+    Checkpointer();
+
+    /**
+     * The destructor saves any waiting checkpoint, then stops the writer
+     * thread.
+     */
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    /**
+     * Takes a checkpoint of the given network, and returns once its 
+     * tables are copied. The checkpoint is saved to the given binary 
+     * agent file in the background. The network must use DENSE storage.
+     *
+     * :param network: Network to save
+     * :param agentFile: path to the file to which we want to save the weights
+     *
+     * :return: Whether the checkpoint was taken
+     */
+    template <unsigned int N>
+    bool save(BasicNTNN<N>& network, const std::string& agentFile)
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        if (!network.snapshot(*pending)) {
+            return false;
+        }
+        return post(lock, agentFile);
+    }
+
+    /**
+     * Takes a delta checkpoint of the given network, holding the parts of
+     * its tables which changed since the last checkpoint, and saves it to
+     * the next delta file of the given agent file in the background. The
+     * network must have been checkpointed (or loaded) first.
+     *
+     * :param network: Network to save
+     * :param agentFile: path to the agent file the delta builds on
+     *
+     * :return: Whether the checkpoint was taken
+     */
+    template <unsigned int N>
+    bool saveDelta(BasicNTNN<N>& network, const std::string& agentFile)
+    {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        changed.wait(lock, [this] { return !hasPending; });
+        if (!network.snapshotDelta(*pending)) {
+            return false;
+        }
+        return post(lock, agentFile);
+    }
+
+    /**
+     * Waits until every checkpoint taken so far is saved.
+     *
+     * :return: Whether every checkpoint since the last wait() was saved
+     */
+    bool wait();
+
+private:
+
+    /**
+     * Hands the pending snapshot, just taken, over to the writer thread.
+     *
+     * :param lock: Lock on the checkpointer's state, released here
+     * :param agentFile: path to the file to which the snapshot is saved
+     *
+     * :return: Whether the checkpoint was taken (always true)
+     */
+    bool post(std::unique_lock<std::mutex>& lock, const std::string& agentFile);
+
+    /**
+     * This function is run by the writer thread. It saves checkpoints as
+     * they come in, until the checkpointer is destroyed.
+     *
+     * :return: (None)
+     */
+    void run();
+
+};
+
+#endif
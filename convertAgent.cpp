@@ -0,0 +1,155 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <memory>
+
+#include "ntnn.hpp"
+
+using namespace std;
+
+/* These values describe the value function of the agent to convert. They
+ * must match the ones afterStateAgent uses, as a binary agent file only
+ * loads into a network built exactly like the one which saved it.
+ *
+ * NUM_TUPLES: The number of tuples in the network
+ * TUPLE_LENGTH: The length of each tuple
+ * WEIGHT_TYPE: Type of the weights of the binary agent file to write,
+ *              unless another type is given on the command line
+ * CSV_FILE: The agent file to convert, which is either in the old CSV
+ *           format (see NTNN::save()) or, if its name does not end in
+ *           ".csv", a binary agent file with any type of weights
+ * BIN_FILE: The binary agent file to write (see NTNN::saveBinary())
+ */
+#define NUM_TUPLES 17
+#define TUPLE_LENGTH 4
+#define WEIGHT_TYPE FLOAT_WEIGHTS
+#define CSV_FILE "agents/TD_AS_AGENT.csv"
+#define BIN_FILE "agents/TD_AS_AGENT.bin"
+
+/* The weight types, in the order of the WeightType enum */
+static const char* WEIGHT_NAMES[] = {"double", "float", "fixed16", "fixed32"};
+
+
+/**
+ * This function adds the tuples of afterStateAgent to a value function.
+ *
+ * :param V: Value function to add the tuples to
+ *
+ * :return: (None)
+ */
+void addTuples(NTNN& V)
+{
+    unsigned int tuples[NUM_TUPLES][TUPLE_LENGTH] = {
+                                                      {0, 1, 2, 3}, {4, 5, 6, 7},
+                                                      {8, 9, 10, 11}, {12, 13, 14, 15},
+                                                      {0, 4, 8, 12}, {1, 5, 9, 13},
+                                                      {2, 6, 10, 14}, {3, 7, 11, 15},
+                                                      {0, 1, 4, 5}, {1, 2, 5, 6},
+                                                      {2, 3, 6, 7}, {4, 5, 8, 9},
+                                                      {5, 6, 9, 10}, {6, 7, 10, 11},
+                                                      {8, 9, 12, 13}, {9, 10, 13, 14},
+                                                      {10, 11, 14, 15}
+                                                    };
+    for (int i = 0; i < NUM_TUPLES; ++i) {
+        V.addTuple(tuples[i], TUPLE_LENGTH);
+    }
+}
+
+
+/**
+ * This function loads a binary agent file into the given value function,
+ * whose weights have the same type as the file's. Each weight type is
+ * tried in turn, as loading checks the file's type before anything else.
+ *
+ * :param agentFile: Binary agent file to load
+ * :param source: Value function holding the loaded agent (return value)
+ *
+ * :return: Whether the agent file was loaded
+ */
+bool loadAnyBinary(const string& agentFile, unique_ptr<NTNN>& source)
+{
+    for (unsigned int type = 0; type < 4; ++type) {
+        source.reset(new NTNN(NUM_TUPLES, TUPLE_LENGTH, 0.0, false, DENSE, WeightType(type)));
+        addTuples(*source);
+
+        if (source->loadBinary(agentFile)) {
+            cout << "Loaded " << agentFile << " with " << WEIGHT_NAMES[type] << " weights" << endl;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * This is the function which runs the program. In this program, we
+ * convert an agent saved in the old CSV format into a binary agent file,
+ * which afterStateAgent loads in no time. A binary agent file can also be
+ * converted to another type of weights, for instance to turn a trained
+ * agent with float weights into a smaller fixed-point agent which only
+ * plays. The input and output files, and the type of the output's
+ * weights (double, float, fixed16 or fixed32), can be given on the
+ * command line, and default to the values defined above.
+ *
+ * :param argc: Number of command line arguments
+ * :param argv: Command line arguments (input file, output file, weight type)
+ *
+ * :return: Error code (0 = no error)
+ */
+int main(int argc, char **argv)
+{
+    string inFile = (argc > 1) ? argv[1] : CSV_FILE;
+    string binFile = (argc > 2) ? argv[2] : BIN_FILE;
+
+    WeightType weightType = WEIGHT_TYPE;
+    if (argc > 3) {
+        unsigned int type = 0;
+        while ((type < 4) && (string(argv[3]) != WEIGHT_NAMES[type])) {
+            ++type;
+        }
+        if (type == 4) {
+            cout << "Unknown weight type " << argv[3] << endl;
+            return 1;
+        }
+        weightType = WeightType(type);
+    }
+
+    /* NTNN::load() quietly skips a missing file, so check for it here */
+    if (!ifstream(inFile).good()) {
+        cout << "Could not open " << inFile << endl;
+        return 1;
+    }
+
+    /* Declare the value function, with the tuples of afterStateAgent */
+    NTNN V(NUM_TUPLES, TUPLE_LENGTH, 0.0, false, DENSE, weightType);
+    addTuples(V);
+
+    bool csv = (inFile.size() >= 4) && (inFile.compare(inFile.size() - 4, 4, ".csv") == 0);
+
+    if (csv) {
+        V.load(inFile);
+    } else {
+        unique_ptr<NTNN> source;
+        if (!loadAnyBinary(inFile, source)) {
+            cout << "Could not load " << inFile << " as a binary agent file" << endl;
+            return 1;
+        }
+        V.convertWeights(*source);
+    }
+
+    if (!V.saveBinary(binFile)) {
+        cout << "Could not write " << binFile << endl;
+        return 1;
+    }
+
+    cout << "Converted " << inFile << " to " << binFile << " with "
+         << WEIGHT_NAMES[weightType] << " weights" << endl;
+    return 0;
+}
@@ -8,28 +8,25 @@
 #include <fstream>
 #include <sstream>
 #include <string>
-#include <limits>
 #include <vector>
-#include <random>
-#include <stdlib.h>
 #include <time.h>
 
 #include "state.hpp"
 #include "game.hpp"
+#include "vecgame.hpp"
 
 using namespace std;
 
-#define NUM_TUPLES 17
-#define TUPLE_LENGTH 4
-
 /* These values are the parameters that define an experiment.
  * GAMES: The number of games per trial
  * EPSILON: The probability of selecting a non-greedy action
  * NUM_EXPERIMENTS: The number of trials to run
+ * BATCH_SIZE: The number of games played side by side
  */
 #define GAMES 200000
 #define EPSILON 0.0
 #define NUM_EXPERIMENTS 30
+#define BATCH_SIZE 1024
 
 
 
@@ -42,110 +39,105 @@ struct Results
 
 
 /**
- * This function computes the best action to take given the current game
- * state, an array of possible actions, and the current value function. 
- * The function chooses the action which maximizes the sum of the value 
- * of the next afterstate and the obtained reward.
+ * This function computes the best action to take in each of the games
+ * of a VecGame, given the games' expansions (see VecGame::expand()).
+ * The greedy action of a game is the legal action with the largest
+ * immediate reward. With probability EPSILON, a random legal action
+ * is taken instead.
  *
- * :param state: Reference to the current state
- * :param actions: Array of available actions in the current state
- * :param numActions: Number of actions in the actions array
- * :param V: Current value function
+ * :param games: Expanded games for which to choose actions
+ * :param rng: Random number generator used to explore
+ * :param actions: Array with the action for each game (return value)
  *
- * :return: The best action to take in the current state
+ * :return: (None)
  */
-Action getBestAction(const State& state, Action* actions, int numActions)
+void getBestActions(const VecGame& games, Rng& rng, Action* actions)
 {
-    Action bestAction;
-    Action a;
-    double bestValue = -numeric_limits<double>::infinity();
-
-    unsigned int reward;
-    double value;
-
-    for (int i = 0; i < numActions; ++i) {
-        
-        a = actions[i];
-        State afterState{state};
-
-        /* Compute the afterstate based on the action */
-        if (a == UP) {
-            reward = afterState.slideUp();
-        } else if (a == DOWN) {
-            reward = afterState.slideDown();
-        } else if (a == LEFT) {
-            reward = afterState.slideLeft();
-        } else {
-            reward = afterState.slideRight();
+    const unsigned int* rewards = games.getRewards();
+    const unsigned char* legalMoves = games.getLegalMoves();
+
+    for (unsigned int i = 0; i < games.getNumGames(); ++i) {
+
+        Action legalActions[NUM_ACTIONS];
+        unsigned int numActions = 0;
+        unsigned int bestReward = 0;
+        Action bestAction = UP;
+
+        /* Compare the rewards of the legal actions */
+        for (unsigned int a = 0; a < NUM_ACTIONS; ++a) {
+            if (legalMoves[i] & (1u << a)) {
+                unsigned int reward = rewards[NUM_ACTIONS*i + a];
+                if ((numActions == 0) || (reward > bestReward)) {
+                    bestReward = reward;
+                    bestAction = static_cast<Action>(a);
+                }
+                legalActions[numActions++] = static_cast<Action>(a);
+            }
         }
 
-        /* Compute the value of the action, and check if 
-         * the action compares favorably to previous results.
-         */
-        if (value > bestValue) {
-            bestValue = value;
-            bestAction = a;
+        if ((numActions > 0) && (rng.nextDouble() < EPSILON)) {
+            bestAction = legalActions[rng.nextBelow(numActions)];
         }
-    }
-
-    random_device rd;
-    mt19937 e2(rd());
-    uniform_real_distribution<> dist(0, 1);
 
-    if (dist(e2) < EPSILON) {
-        bestAction = static_cast<Action>(int(rand()));
+        actions[i] = bestAction;
     }
-
-    return bestAction;
 }
 
 
 /**
- * This function runs the temporal difference learning algorithm on 
- * the 2048 game afterstates. The scores and outcomes of the games which
- * the algorithms played are stored in the given, pre-allocated arrays.
+ * This function plays GAMES games with the epsilon greedy policy. The
+ * games are played BATCH_SIZE at a time, side by side, by a VecGame.
+ * The results are recorded in the order in which the games started, so
+ * they cover exactly the first GAMES games, however long each one lasts.
+ *
+ * :param seed: Seed from which the seeds of the games are derived
  *
  * :return: The results of the experiment (wins and scores as a function of
  *          number of games played)
  */
-Results epsilonGreedyPlaying()
+Results epsilonGreedyPlaying(uint64_t seed)
 {
     /* Create the struct to store the experiment results */
     Results results;
-    
-    Action actions[4];
-    unsigned int numActions;
-    
-    for (unsigned int gameIndex = 0; gameIndex < GAMES; ++gameIndex)
-    {
-        Game game;
-        numActions = game.getActions(actions);
+    results.scores.resize(GAMES);
+    results.wins.resize(GAMES);
 
-        State state;
-        Action bestAction;
-        unsigned int reward;
+    VecGame games{BATCH_SIZE, seed};
+    Rng rng{seed};
 
-        while (numActions > 0)
-        {
-            state = game.getState();
-            bestAction = getBestAction(state, actions, numActions);
+    vector<Action> actions(BATCH_SIZE);
+    vector<EpisodeResult> finished(BATCH_SIZE);
+    unsigned int numRecorded = 0;
 
-            reward = game.takeAction(bestAction);
-            numActions = game.getActions(actions);
-        }
+    while (numRecorded < GAMES)
+    {
+        games.expand();
+        getBestActions(games, rng, actions.data());
+        unsigned int numFinished = games.step(actions.data(), finished.data());
 
-        /* Print out the progress of the current experiment */
-        if (gameIndex % 10 == 0)
+        for (unsigned int i = 0; i < numFinished; ++i)
         {
-            cout << "Percent Complete: ";
-            cout << 100.0*double(gameIndex + 1) / double(GAMES);
-            cout << "; Game score: " << game.getScore() << "   ";
-            cout << "\r" << flush;
-        }
+            /* Games started after the first GAMES are not recorded */
+            uint64_t gameIndex = finished[i].episode;
+            if (gameIndex >= GAMES)
+            {
+                continue;
+            }
 
-        /* Record the results of the current game */
-        results.scores.push_back(game.getScore());
-        results.wins.push_back((game.getMaxTile() >= 2048));
+            /* Print out the progress of the current experiment */
+            if (numRecorded % 10 == 0)
+            {
+                cout << "Percent Complete: ";
+                cout << 100.0*double(numRecorded + 1) / double(GAMES);
+                cout << "; Game score: " << finished[i].score << "   ";
+                cout << "\r" << flush;
+            }
+
+            /* Record the results of the finished game */
+            results.scores[gameIndex] = finished[i].score;
+            results.wins[gameIndex] = (finished[i].maxTile >= 2048);
+            ++numRecorded;
+        }
     }
 
     /* Move the cursor to the next line */
@@ -169,11 +161,14 @@ Results epsilonGreedyPlaying()
  */
 int main(int argc, char **argv)
 {
-    /* Initialize the random seed */
-    srand(time(NULL));
+    /* Every game's seed is derived from this master seed, so printing
+     * it lets us reproduce the experiment later on.
+     */
+    uint64_t masterSeed = time(NULL);
 
     cout << "Epsilon: " << EPSILON << endl;
     cout << "Number of Games per Experiment: " << GAMES << endl;
+    cout << "Seed: " << masterSeed << endl;
 
     for (int experiment = 1; experiment <= NUM_EXPERIMENTS; ++experiment)
     {
@@ -181,7 +176,7 @@ int main(int argc, char **argv)
         cout << "Experiment " << experiment << " / " << NUM_EXPERIMENTS << endl;
 
         /* Collect the results from each of the experiments */
-        Results experimentResults = epsilonGreedyPlaying();
+        Results experimentResults = epsilonGreedyPlaying(Rng::streamSeed(masterSeed, experiment));
 
         /* Create the names of the results files */
         ostringstream scoresFileName;
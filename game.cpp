@@ -4,29 +4,61 @@
  * Final Project
  */
 
+#include <random>
 #include "game.hpp"
 
 
+/**
+ * Draws a 64-bit seed from the system's entropy source. This is only
+ * done once per game, never once per move.
+ */
+static uint64_t entropySeed()
+{
+    std::random_device rd;
+    return (uint64_t(rd()) << 32) | uint64_t(rd());
+}
+
+
+template <unsigned int N>
+BasicGame<N>::BasicGame()
+    : BasicGame(entropySeed())
+{
+}
+
 
-unsigned int Game::getScore() const
+template <unsigned int N>
+BasicGame<N>::BasicGame(uint64_t seed)
+    : rng{seed}
+{
+    /* Start by inserting two tiles into the grid */
+    state.insertNewTile(rng);
+    state.insertNewTile(rng);
+}
+
+
+template <unsigned int N>
+unsigned int BasicGame<N>::getScore() const
 {
     return score;
 }
 
 
-unsigned int Game::getMaxTile() const
+template <unsigned int N>
+unsigned int BasicGame<N>::getMaxTile() const
 {
     return state.getMaxTile();
 }
 
 
-State Game::getState() const
+template <unsigned int N>
+BasicState<N> BasicGame<N>::getState() const
 {
     return state;
 }
 
 
-unsigned int Game::takeAction(Action a)
+template <unsigned int N>
+unsigned int BasicGame<N>::takeAction(Action a)
 {
     unsigned int reward;
     bool validAction = true;
@@ -47,7 +79,7 @@ unsigned int Game::takeAction(Action a)
 
     /* Only insert a tile if the action was valid */
     if (validAction) {
-        state.insertNewTile();
+        state.insertNewTile(rng);
     }
 
     score += reward;
@@ -55,7 +87,8 @@ unsigned int Game::takeAction(Action a)
 }
 
 
-unsigned int Game::takeAction(Action a, State& afterState)
+template <unsigned int N>
+unsigned int BasicGame<N>::takeAction(Action a, BasicState<N>& afterState)
 {
     unsigned int reward;
     bool validAction = true;
@@ -77,9 +110,9 @@ unsigned int Game::takeAction(Action a, State& afterState)
     /* Copy the state to the afterState variable (for return), and 
      * insert a tile if the action we took was a valid one.
      */
-    afterState = State{state};
+    afterState = state;
     if (validAction) {
-        state.insertNewTile();
+        state.insertNewTile(rng);
     }
 
     score += reward;
@@ -87,7 +120,8 @@ unsigned int Game::takeAction(Action a, State& afterState)
 }
 
 
-unsigned int Game::pretendTakeAction(Action a, State& afterState) const
+template <unsigned int N>
+unsigned int BasicGame<N>::pretendTakeAction(Action a, BasicState<N>& afterState) const
 {
     unsigned int reward;
     afterState = state;
@@ -115,42 +149,93 @@ unsigned int Game::pretendTakeAction(Action a, State& afterState) const
 }
 
 
-unsigned int Game::getActions(Action actions[NUM_ACTIONS]) const
+template <unsigned int N>
+BasicExpansion<N> BasicGame<N>::expand() const
 {
-    /* Create some new variables to create and store afterstates 
-     * for each of the game's four actions.
-     */
-    State upState{state};
-    State downState{state};
-    State leftState{state};
-    State rightState{state};
+    BasicExpansion<N> expansion;
+    expansion.legalMoves = 0;
+
+    for (unsigned int a = 0; a < NUM_ACTIONS; ++a) {
+        BasicState<N>& afterState = expansion.afterStates[a];
+        afterState = state;
+
+        unsigned int reward;
+        if (a == UP) {
+            reward = afterState.slideUp();
+        } else if (a == DOWN) {
+            reward = afterState.slideDown();
+        } else if (a == LEFT) {
+            reward = afterState.slideLeft();
+        } else {
+            reward = afterState.slideRight();
+        }
+
+        /* Rewards are sums of powers of two, so the position of the
+         * highest set bit is the logarithm, rounded down.
+         */
+        expansion.rewards[a] = reward;
+        expansion.logRewards[a] = (reward != 0) ? 31 - __builtin_clz(reward) : 0;
+
+        if (afterState != state) {
+            expansion.legalMoves |= 1u << a;
+        }
+    }
 
-    upState.slideUp();
-    downState.slideDown();
-    leftState.slideLeft();
-    rightState.slideRight();
+    return expansion;
+}
 
-    unsigned int numActions = 0;
 
-    /* If the afterstate for an action is different than the current 
-     * state, then the action leading to that afterstate is a valid
-     * action to take. Otherwise, we omit it from our action array.
-     */
-    if (upState != state) {
-        actions[numActions++] = UP;
+template <unsigned int N>
+unsigned int BasicGame<N>::takeAction(Action a, const BasicExpansion<N>& expansion)
+{
+    /* Anything but one of the four actions leaves the game unchanged */
+    if ((unsigned int) a >= NUM_ACTIONS) {
+        return 0;
     }
 
-    if (downState != state) {
-        actions[numActions++] = DOWN;
-    }
+    state = expansion.afterStates[a];
+    state.insertNewTile(rng);
 
-    if (leftState != state) {
-        actions[numActions++] = LEFT;
-    }
+    score += expansion.rewards[a];
+    return expansion.rewards[a];
+}
 
-    if (rightState != state) {
-        actions[numActions++] = RIGHT;
+
+template <unsigned int N>
+unsigned int BasicGame<N>::getActions(Action actions[NUM_ACTIONS]) const
+{
+    unsigned int legalMoves = state.getLegalMoves();
+    unsigned int numActions = 0;
+
+    /* An action is valid when it changes the state. The legal move mask
+     * has one bit per action, in the order of the Action enum.
+     */
+    for (unsigned int a = 0; a < NUM_ACTIONS; ++a) {
+        if (legalMoves & (1u << a)) {
+            actions[numActions++] = static_cast<Action>(a);
+        }
     }
 
     return numActions;
 }
+
+
+template <unsigned int N>
+unsigned int BasicGame<N>::getLegalMoves() const
+{
+    return state.getLegalMoves();
+}
+
+
+template <unsigned int N>
+bool BasicGame<N>::isTerminal() const
+{
+    return state.isTerminal();
+}
+
+
+/* Compile every supported board size */
+template class BasicGame<3>;
+template class BasicGame<4>;
+template class BasicGame<5>;
+template class BasicGame<6>;
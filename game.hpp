@@ -7,7 +7,9 @@
 #ifndef GAME_H
 #define GAME_H 1
 
+#include <cstdint>
 #include "state.hpp"
+#include "rng.hpp"
 
 #define NUM_ACTIONS 4
 
@@ -19,9 +21,32 @@
 enum Action {UP, DOWN, LEFT, RIGHT};
 
 /**
- * Class which contains everything you need to run a 2048 game.
+ * This structure holds every move out of a game state, as computed by
+ * Game::expand(). Entry a of each array belongs to the action a.
+ */
+template <unsigned int N>
+struct BasicExpansion
+{
+    /* State after each move, before the random tile insert */
+    BasicState<N> afterStates[NUM_ACTIONS];
+
+    /* Reward for each move */
+    unsigned int rewards[NUM_ACTIONS];
+
+    /* Base 2 logarithm of each reward, rounded down (0 for no reward) */
+    unsigned int logRewards[NUM_ACTIONS];
+
+    /* Mask of the possible moves, with bit a set when a changes the state */
+    unsigned int legalMoves;
+};
+
+/**
+ * Class which contains everything you need to run a 2048 game on an
+ * N x N board. The programs use the GRID_SIZE x GRID_SIZE game through
+ * the Game type defined below.
  */ 
-class Game
+template <unsigned int N>
+class BasicGame
 {
 
 private:
@@ -29,11 +54,34 @@ private:
     /* Current score of the game */
     unsigned int score = 0;
 
+    /* Random number generator used to spawn the game's tiles */
+    Rng rng;
+
     /* Current state of the game */
-    State state;
+    BasicState<N> state;
 
 public:
 
+    /**
+     * The constructor for a Game object. The game's random number 
+     * generator is seeded from the system's entropy source, so every 
+     * game plays out differently.
+     *
+     * :return: New Game object, with its two starting tiles in place
+     */
+    BasicGame();
+
+    /**
+     * The constructor for a Game object with an explicit seed. Two games
+     * created with the same seed, and played with the same moves, are 
+     * identical. Use Rng::streamSeed() to seed the games of an experiment.
+     *
+     * :param seed: Seed for the game's random number generator
+     *
+     * :return: New Game object, with its two starting tiles in place
+     */
+    explicit BasicGame(uint64_t seed);
+
     /**
      * Gets the current score for the game.
      *
@@ -75,7 +123,7 @@ public:
      *
      * :return: Reward for executing the given action (move)
      */
-    unsigned int takeAction(Action a, State& afterState);
+    unsigned int takeAction(Action a, BasicState<N>& afterState);
 
     /**
      * This function allows the player to pretend to execute a move on 
@@ -88,14 +136,38 @@ public:
      *
      * :return: Reward for executing the given action (move)
      */
-    unsigned int pretendTakeAction(Action a, State& afterState) const;
+    unsigned int pretendTakeAction(Action a, BasicState<N>& afterState) const;
+
+    /**
+     * Computes every move out of the current game state at once: the
+     * afterstate and reward of each action, and which actions are
+     * possible. The state of the game DOES NOT change. Pass the result 
+     * to takeAction() to execute one of the moves without sliding the
+     * tiles again.
+     *
+     * :return: Expansion of the current game state
+     */
+    BasicExpansion<N> expand() const;
+
+    /**
+     * This function executes a move which was computed by expand(). The
+     * expansion must belong to the current game state, and the action 
+     * should be one of the actions defined for the game. Otherwise, the 
+     * game state will stay the same.
+     *
+     * :param a: Action (move) to take on the game
+     * :param expansion: Expansion of the current game state
+     *
+     * :return: Reward for executing the given action (move)
+     */
+    unsigned int takeAction(Action a, const BasicExpansion<N>& expansion);
 
     /**
      * Gets the current state for the game.
      *
      * :return: Current state of the game
      */
-    State getState() const;
+    BasicState<N> getState() const;
 
     /**
      * Gets the possible actions for the current game state. The actions
@@ -107,7 +179,28 @@ public:
      * :return: The number of possible actions for the given game state
      */
     unsigned int getActions(Action actions[NUM_ACTIONS]) const;
+
+    /**
+     * Gets the possible actions for the current game state as a mask,
+     * where bit a is set when the action a is possible. This is cheaper
+     * than getActions(), as no afterstates are built.
+     *
+     * :return: Mask of the possible actions for the current game state
+     */
+    unsigned int getLegalMoves() const;
+
+    /**
+     * Checks whether the game is over, that is, whether no actions are
+     * possible from the current game state.
+     *
+     * :return: Whether the game is over
+     */
+    bool isTerminal() const;
 };
 
 
+/* The game the programs play */
+typedef BasicGame<GRID_SIZE> Game;
+typedef BasicExpansion<GRID_SIZE> Expansion;
+
 #endif
@@ -0,0 +1,351 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include <cstring>
+#include <immintrin.h>
+#include "movekernel.hpp"
+#include "moves.hpp"
+
+
+/* Signature shared by all of the expansion kernels */
+typedef void (*ExpandKernel)(const uint64_t*, unsigned int, uint64_t*, unsigned int*, unsigned char*);
+
+
+/**
+ * Slides every row of a packed board both left and right with the row
+ * lookup tables, and returns the reward shared by both slides.
+ */
+static inline unsigned int lookupRows(uint64_t board, uint64_t& left, uint64_t& right)
+{
+    unsigned int reward = 0;
+    left = 0;
+    right = 0;
+
+    for (unsigned int shift = 0; shift < 64; shift += 16) {
+        unsigned int row = (board >> shift) & 0xFFFF;
+        uint32_t slides = rowSlides[row];
+        left |= uint64_t(slides & 0xFFFF) << shift;
+        right |= uint64_t(slides >> 16) << shift;
+        reward += rowRewards[row];
+    }
+
+    return reward;
+}
+
+
+/**
+ * Stores the results for a single board once its four afterstates
+ * and its row and column rewards are known.
+ */
+static inline void storeExpansion(uint64_t board, uint64_t up, uint64_t down, uint64_t left,
+                                  uint64_t right, unsigned int colReward, unsigned int rowReward,
+                                  uint64_t* afterStates, unsigned int* rewards, unsigned char* legalMoves)
+{
+    afterStates[0] = up;
+    afterStates[1] = down;
+    afterStates[2] = left;
+    afterStates[3] = right;
+
+    rewards[0] = colReward;
+    rewards[1] = colReward;
+    rewards[2] = rowReward;
+    rewards[3] = rowReward;
+
+    *legalMoves = (up != board) | ((down != board) << 1) | ((left != board) << 2) | ((right != board) << 3);
+}
+
+
+/**
+ * The scalar kernel. This is also used to finish off the boards left
+ * over when the count is not a multiple of the SIMD kernels' width.
+ */
+static void expandBoardsScalar(const uint64_t* boards, unsigned int count, uint64_t* afterStates,
+                               unsigned int* rewards, unsigned char* legalMoves)
+{
+    uint64_t up, down, left, right;
+    unsigned int rowReward, colReward;
+
+    for (unsigned int i = 0; i < count; ++i) {
+
+        uint64_t board = boards[i];
+        rowReward = lookupRows(board, left, right);
+        colReward = lookupRows(transposeBoard(board), up, down);
+
+        storeExpansion(board, transposeBoard(up), transposeBoard(down), left, right,
+                       colReward, rowReward, afterStates + 4*i, rewards + 4*i, legalMoves + i);
+    }
+}
+
+
+/**
+ * The SSE4.1 kernel handles two boards per register. The transposes and
+ * the legality comparisons are done in vector registers, while the row
+ * lookups themselves stay scalar (SSE has no gather instruction).
+ */
+__attribute__((target("sse4.1")))
+static inline __m128i transposeBoardsSSE(__m128i boards)
+{
+    __m128i a1 = _mm_and_si128(boards, _mm_set1_epi64x(0xF0F00F0FF0F00F0FULL));
+    __m128i a2 = _mm_and_si128(boards, _mm_set1_epi64x(0x0000F0F00000F0F0ULL));
+    __m128i a3 = _mm_and_si128(boards, _mm_set1_epi64x(0x0F0F00000F0F0000ULL));
+    __m128i a = _mm_or_si128(a1, _mm_or_si128(_mm_slli_epi64(a2, 12), _mm_srli_epi64(a3, 12)));
+
+    __m128i b1 = _mm_and_si128(a, _mm_set1_epi64x(0xFF00FF0000FF00FFULL));
+    __m128i b2 = _mm_and_si128(a, _mm_set1_epi64x(0x00FF00FF00000000ULL));
+    __m128i b3 = _mm_and_si128(a, _mm_set1_epi64x(0x00000000FF00FF00ULL));
+    return _mm_or_si128(b1, _mm_or_si128(_mm_srli_epi64(b2, 24), _mm_slli_epi64(b3, 24)));
+}
+
+__attribute__((target("sse4.1")))
+static void expandBoardsSSE41(const uint64_t* boards, unsigned int count, uint64_t* afterStates,
+                              unsigned int* rewards, unsigned char* legalMoves)
+{
+    unsigned int i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+
+        __m128i board = _mm_loadu_si128((const __m128i*) (boards + i));
+        __m128i transposed = transposeBoardsSSE(board);
+
+        uint64_t up[2], down[2], left[2], right[2];
+        unsigned int rowReward[2], colReward[2];
+
+        for (int k = 0; k < 2; ++k) {
+            uint64_t rows = (k == 0) ? _mm_extract_epi64(board, 0) : _mm_extract_epi64(board, 1);
+            uint64_t cols = (k == 0) ? _mm_extract_epi64(transposed, 0) : _mm_extract_epi64(transposed, 1);
+            rowReward[k] = lookupRows(rows, left[k], right[k]);
+            colReward[k] = lookupRows(cols, up[k], down[k]);
+        }
+
+        __m128i upBoards = transposeBoardsSSE(_mm_loadu_si128((const __m128i*) up));
+        __m128i downBoards = transposeBoardsSSE(_mm_loadu_si128((const __m128i*) down));
+        __m128i leftBoards = _mm_loadu_si128((const __m128i*) left);
+        __m128i rightBoards = _mm_loadu_si128((const __m128i*) right);
+
+        /* A move is legal when its afterstate differs from the board */
+        int upSame = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(upBoards, board)));
+        int downSame = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(downBoards, board)));
+        int leftSame = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(leftBoards, board)));
+        int rightSame = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(rightBoards, board)));
+
+        /* Interleave the four directions of each board for the output */
+        uint64_t* out = afterStates + 4*i;
+        _mm_storeu_si128((__m128i*) (out + 0), _mm_unpacklo_epi64(upBoards, downBoards));
+        _mm_storeu_si128((__m128i*) (out + 2), _mm_unpacklo_epi64(leftBoards, rightBoards));
+        _mm_storeu_si128((__m128i*) (out + 4), _mm_unpackhi_epi64(upBoards, downBoards));
+        _mm_storeu_si128((__m128i*) (out + 6), _mm_unpackhi_epi64(leftBoards, rightBoards));
+
+        for (int k = 0; k < 2; ++k) {
+            rewards[4*(i+k) + 0] = colReward[k];
+            rewards[4*(i+k) + 1] = colReward[k];
+            rewards[4*(i+k) + 2] = rowReward[k];
+            rewards[4*(i+k) + 3] = rowReward[k];
+
+            legalMoves[i+k] = (~(((upSame >> k) & 1) | (((downSame >> k) & 1) << 1) |
+                                 (((leftSame >> k) & 1) << 2) | (((rightSame >> k) & 1) << 3))) & 0xF;
+        }
+    }
+
+    expandBoardsScalar(boards + i, count - i, afterStates + 4*i, rewards + 4*i, legalMoves + i);
+}
+
+
+/**
+ * The AVX2 kernel handles eight boards per iteration, held as two
+ * registers of four boards each. For every row position it pulls that
+ * row out of all eight boards into one register of 32-bit lanes (the
+ * first four boards in the even lanes, the last four in the odd lanes),
+ * and then looks up all eight rows with a single gather.
+ */
+__attribute__((target("avx2")))
+static inline __m256i transposeBoardsAVX2(__m256i boards)
+{
+    __m256i a1 = _mm256_and_si256(boards, _mm256_set1_epi64x(0xF0F00F0FF0F00F0FULL));
+    __m256i a2 = _mm256_and_si256(boards, _mm256_set1_epi64x(0x0000F0F00000F0F0ULL));
+    __m256i a3 = _mm256_and_si256(boards, _mm256_set1_epi64x(0x0F0F00000F0F0000ULL));
+    __m256i a = _mm256_or_si256(a1, _mm256_or_si256(_mm256_slli_epi64(a2, 12), _mm256_srli_epi64(a3, 12)));
+
+    __m256i b1 = _mm256_and_si256(a, _mm256_set1_epi64x(0xFF00FF0000FF00FFULL));
+    __m256i b2 = _mm256_and_si256(a, _mm256_set1_epi64x(0x00FF00FF00000000ULL));
+    __m256i b3 = _mm256_and_si256(a, _mm256_set1_epi64x(0x00000000FF00FF00ULL));
+    return _mm256_or_si256(b1, _mm256_or_si256(_mm256_srli_epi64(b2, 24), _mm256_slli_epi64(b3, 24)));
+}
+
+/**
+ * Slides the rows of eight boards (four in each of first and second)
+ * left and right, and adds each board's reward to its lane of rewards.
+ */
+__attribute__((target("avx2")))
+static inline void slideRowsAVX2(__m256i first, __m256i second, __m256i& firstLeft, __m256i& firstRight,
+                                 __m256i& secondLeft, __m256i& secondRight, __m256i& rewards)
+{
+    const __m256i rowMask = _mm256_set1_epi64x(0xFFFF);
+    const __m256i lowMask = _mm256_set1_epi64x(0xFFFFFFFF);
+
+    firstLeft = _mm256_setzero_si256();
+    firstRight = _mm256_setzero_si256();
+    secondLeft = _mm256_setzero_si256();
+    secondRight = _mm256_setzero_si256();
+
+    for (int shift = 0; shift < 64; shift += 16) {
+
+        __m128i count = _mm_cvtsi32_si128(shift);
+        __m256i firstRows = _mm256_and_si256(_mm256_srl_epi64(first, count), rowMask);
+        __m256i secondRows = _mm256_and_si256(_mm256_srl_epi64(second, count), rowMask);
+        __m256i rows = _mm256_blend_epi32(firstRows, _mm256_slli_epi64(secondRows, 32), 0xAA);
+
+        __m256i slides = _mm256_i32gather_epi32((const int*) rowSlides, rows, 4);
+        rewards = _mm256_add_epi32(rewards, _mm256_i32gather_epi32((const int*) rowRewards, rows, 4));
+
+        __m256i firstSlides = _mm256_and_si256(slides, lowMask);
+        __m256i secondSlides = _mm256_srli_epi64(slides, 32);
+
+        firstLeft = _mm256_or_si256(firstLeft, _mm256_sll_epi64(_mm256_and_si256(firstSlides, rowMask), count));
+        firstRight = _mm256_or_si256(firstRight, _mm256_sll_epi64(_mm256_srli_epi64(firstSlides, 16), count));
+        secondLeft = _mm256_or_si256(secondLeft, _mm256_sll_epi64(_mm256_and_si256(secondSlides, rowMask), count));
+        secondRight = _mm256_or_si256(secondRight, _mm256_sll_epi64(_mm256_srli_epi64(secondSlides, 16), count));
+    }
+}
+
+/**
+ * Writes the four afterstates of four boards in the output order, which
+ * is a 4x4 transpose of the up, down, left and right registers.
+ */
+__attribute__((target("avx2")))
+static inline void storeAfterStatesAVX2(uint64_t* out, __m256i up, __m256i down, __m256i left, __m256i right)
+{
+    __m256i upDownEven = _mm256_unpacklo_epi64(up, down);
+    __m256i upDownOdd = _mm256_unpackhi_epi64(up, down);
+    __m256i leftRightEven = _mm256_unpacklo_epi64(left, right);
+    __m256i leftRightOdd = _mm256_unpackhi_epi64(left, right);
+
+    _mm256_storeu_si256((__m256i*) (out + 0), _mm256_permute2x128_si256(upDownEven, leftRightEven, 0x20));
+    _mm256_storeu_si256((__m256i*) (out + 4), _mm256_permute2x128_si256(upDownOdd, leftRightOdd, 0x20));
+    _mm256_storeu_si256((__m256i*) (out + 8), _mm256_permute2x128_si256(upDownEven, leftRightEven, 0x31));
+    _mm256_storeu_si256((__m256i*) (out + 12), _mm256_permute2x128_si256(upDownOdd, leftRightOdd, 0x31));
+}
+
+/**
+ * Returns a 4-bit mask with bit k set when lane k of the two registers
+ * holds the same board.
+ */
+__attribute__((target("avx2")))
+static inline unsigned int sameBoardsAVX2(__m256i a, __m256i b)
+{
+    return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b)));
+}
+
+__attribute__((target("avx2")))
+static void expandBoardsAVX2(const uint64_t* boards, unsigned int count, uint64_t* afterStates,
+                             unsigned int* rewards, unsigned char* legalMoves)
+{
+    /* Moves the lanes of a reward register back into board order */
+    const __m256i boardOrder = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    unsigned int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+
+        __m256i first = _mm256_loadu_si256((const __m256i*) (boards + i));
+        __m256i second = _mm256_loadu_si256((const __m256i*) (boards + i + 4));
+
+        __m256i firstLeft, firstRight, secondLeft, secondRight;
+        __m256i firstUp, firstDown, secondUp, secondDown;
+        __m256i rowRewardLanes = _mm256_setzero_si256();
+        __m256i colRewardLanes = _mm256_setzero_si256();
+
+        slideRowsAVX2(first, second, firstLeft, firstRight, secondLeft, secondRight, rowRewardLanes);
+        slideRowsAVX2(transposeBoardsAVX2(first), transposeBoardsAVX2(second),
+                      firstUp, firstDown, secondUp, secondDown, colRewardLanes);
+
+        firstUp = transposeBoardsAVX2(firstUp);
+        firstDown = transposeBoardsAVX2(firstDown);
+        secondUp = transposeBoardsAVX2(secondUp);
+        secondDown = transposeBoardsAVX2(secondDown);
+
+        storeAfterStatesAVX2(afterStates + 4*i, firstUp, firstDown, firstLeft, firstRight);
+        storeAfterStatesAVX2(afterStates + 4*(i+4), secondUp, secondDown, secondLeft, secondRight);
+
+        uint32_t rowReward[8], colReward[8];
+        _mm256_storeu_si256((__m256i*) rowReward, _mm256_permutevar8x32_epi32(rowRewardLanes, boardOrder));
+        _mm256_storeu_si256((__m256i*) colReward, _mm256_permutevar8x32_epi32(colRewardLanes, boardOrder));
+
+        /* Bits 0-3 of each mask cover the first four boards, 4-7 the rest */
+        unsigned int upSame = sameBoardsAVX2(firstUp, first) | (sameBoardsAVX2(secondUp, second) << 4);
+        unsigned int downSame = sameBoardsAVX2(firstDown, first) | (sameBoardsAVX2(secondDown, second) << 4);
+        unsigned int leftSame = sameBoardsAVX2(firstLeft, first) | (sameBoardsAVX2(secondLeft, second) << 4);
+        unsigned int rightSame = sameBoardsAVX2(firstRight, first) | (sameBoardsAVX2(secondRight, second) << 4);
+
+        for (int k = 0; k < 8; ++k) {
+            rewards[4*(i+k) + 0] = colReward[k];
+            rewards[4*(i+k) + 1] = colReward[k];
+            rewards[4*(i+k) + 2] = rowReward[k];
+            rewards[4*(i+k) + 3] = rowReward[k];
+
+            legalMoves[i+k] = (~(((upSame >> k) & 1) | (((downSame >> k) & 1) << 1) |
+                                 (((leftSame >> k) & 1) << 2) | (((rightSame >> k) & 1) << 3))) & 0xF;
+        }
+    }
+
+    expandBoardsScalar(boards + i, count - i, afterStates + 4*i, rewards + 4*i, legalMoves + i);
+}
+
+
+/**
+ * Picks the fastest kernel supported by the CPU we are running on.
+ */
+static ExpandKernel selectKernel(const char** name)
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return expandBoardsAVX2;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        *name = "sse4.1";
+        return expandBoardsSSE41;
+    }
+
+    *name = "scalar";
+    return expandBoardsScalar;
+}
+
+
+static const char* kernelName = "";
+
+
+void expandBoards(const uint64_t* boards, unsigned int count, uint64_t* afterStates,
+                  unsigned int* rewards, unsigned char* legalMoves)
+{
+    static const ExpandKernel kernel = selectKernel(&kernelName);
+    kernel(boards, count, afterStates, rewards, legalMoves);
+}
+
+
+const char* getMoveKernelName()
+{
+    /* Make sure the kernel has been chosen before reporting it */
+    expandBoards(nullptr, 0, nullptr, nullptr, nullptr);
+    return kernelName;
+}
+
+
+bool expandBoardsWith(const char* kernel, const uint64_t* boards, unsigned int count,
+                      uint64_t* afterStates, unsigned int* rewards, unsigned char* legalMoves)
+{
+    __builtin_cpu_init();
+
+    if ((strcmp(kernel, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        expandBoardsAVX2(boards, count, afterStates, rewards, legalMoves);
+    } else if ((strcmp(kernel, "sse4.1") == 0) && __builtin_cpu_supports("sse4.1")) {
+        expandBoardsSSE41(boards, count, afterStates, rewards, legalMoves);
+    } else if (strcmp(kernel, "scalar") == 0) {
+        expandBoardsScalar(boards, count, afterStates, rewards, legalMoves);
+    } else {
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,64 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#ifndef MOVEKERNEL_H
+#define MOVEKERNEL_H 1
+
+#include <cstdint>
+
+
+/**
+ * This function is the batched version of the move engine. It slides
+ * each of the given packed boards in all four directions at once, and
+ * reports every afterstate, every reward, and which moves are legal.
+ *
+ * The results for board i are stored at index 4*i + a of afterStates
+ * and rewards, where a is the direction in the order of the Action enum
+ * (UP, DOWN, LEFT, RIGHT). Bit a of legalMoves[i] is set when sliding
+ * in direction a changes the board.
+ *
+ * The work is done by the fastest kernel the CPU supports (AVX2, then
+ * SSE4.1, then plain scalar code), which is chosen on the first call.
+ * All of the kernels produce identical results.
+ *
+ * :param boards: Array of packed boards to expand
+ * :param count: Number of boards in the boards array
+ * :param afterStates: Array of 4*count afterstates (return value)
+ * :param rewards: Array of 4*count rewards (return value)
+ * :param legalMoves: Array of count legal move masks (return value)
+ *
+ * :return: (None)
+ */
+void expandBoards(const uint64_t* boards, unsigned int count, uint64_t* afterStates,
+                  unsigned int* rewards, unsigned char* legalMoves);
+
+/**
+ * Returns the name of the kernel expandBoards() uses on this CPU,
+ * which is handy when reporting benchmark results.
+ *
+ * :return: "avx2", "sse4.1" or "scalar"
+ */
+const char* getMoveKernelName();
+
+/**
+ * Expands boards like expandBoards(), but with the named kernel rather
+ * than the fastest one, so that the kernels can be checked against
+ * each other (see checkMoveKernel.cpp).
+ *
+ * :param kernel: Name of the kernel: "avx2", "sse4.1" or "scalar"
+ * :param boards: Array of packed boards to expand
+ * :param count: Number of boards in the boards array
+ * :param afterStates: Array of 4*count afterstates (return value)
+ * :param rewards: Array of 4*count rewards (return value)
+ * :param legalMoves: Array of count legal move masks (return value)
+ *
+ * :return: Whether the kernel exists and the CPU supports it (if not,
+ *          nothing is expanded)
+ */
+bool expandBoardsWith(const char* kernel, const uint64_t* boards, unsigned int count,
+                      uint64_t* afterStates, unsigned int* rewards, unsigned char* legalMoves);
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include "moves.hpp"
+#include "state.hpp"
+
+
+uint32_t rowSlides[NUM_ROWS];
+uint32_t rowRewards[NUM_ROWS];
+uint8_t rowMoves[NUM_ROWS];
+
+
+/**
+ * Slides the four cells of a row to the left, merging equal tiles, and
+ * returns the reward earned by the merges.
+ *
+ * This code is quite similar to the action code used by
+ * Szubert and Jaskowski in their 2048 project.
+ * You can find the original code here:
+ * https://github.com/mszubert/2048
+ */
+static unsigned int slideCellsLeft(unsigned int cells[4])
+{
+    unsigned int reward = 0;
+    int firstFreeCol = 0;
+    bool alreadyAggregated = false;
+
+    for (int col = 0; col < 4; ++col) {
+
+        unsigned int exponent = cells[col];
+        if (exponent == 0) {
+            continue;
+        }
+
+        if ((firstFreeCol > 0) && (!alreadyAggregated) && (exponent < MAX_EXPONENT) && (cells[firstFreeCol-1] == exponent)) {
+            cells[firstFreeCol-1] = exponent + 1;
+            cells[col] = 0;
+            reward += 1u << (exponent + 1);
+            alreadyAggregated = true;
+        } else {
+            cells[col] = 0;
+            cells[firstFreeCol++] = exponent;
+            alreadyAggregated = false;
+        }
+    }
+
+    return reward;
+}
+
+
+/**
+ * Converts between a 16-bit row and its four cells. The leftmost cell
+ * is the most significant nibble of the row.
+ */
+static void unpackRow(unsigned int row, unsigned int cells[4])
+{
+    for (int col = 0; col < 4; ++col) {
+        cells[col] = (row >> (12 - 4*col)) & 0xF;
+    }
+}
+
+static unsigned int packRow(const unsigned int cells[4])
+{
+    unsigned int row = 0;
+    for (int col = 0; col < 4; ++col) {
+        row |= cells[col] << (12 - 4*col);
+    }
+    return row;
+}
+
+
+/**
+ * Fills the row tables for every possible row. Sliding right
+ * is done by reversing the row, sliding it left, and reversing it back.
+ */
+static bool initializeMoveTables()
+{
+    unsigned int cells[4];
+    unsigned int reversed[4];
+
+    for (unsigned int row = 0; row < NUM_ROWS; ++row) {
+
+        unpackRow(row, cells);
+        for (int col = 0; col < 4; ++col) {
+            reversed[col] = cells[3 - col];
+        }
+
+        rowRewards[row] = slideCellsLeft(cells);
+        slideCellsLeft(reversed);
+
+        unsigned int left = packRow(cells);
+        unsigned int right = 0;
+        for (int col = 0; col < 4; ++col) {
+            right |= reversed[col] << (4*col);
+        }
+
+        rowSlides[row] = left | (right << 16);
+        rowMoves[row] = (left != row) | ((right != row) << 1);
+    }
+
+    return true;
+}
+
+static bool tablesInitialized = initializeMoveTables();
@@ -0,0 +1,178 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#ifndef MOVES_H
+#define MOVES_H 1
+
+#include <cstdint>
+
+/* Number of distinct rows of four 4-bit cells */
+#define NUM_ROWS 65536
+
+/**
+ * This is the table-driven move engine used by State. Rather than running
+ * the slide loops on every move, we slide every possible 16-bit row once
+ * at startup and store the results. A row is laid out like a row of the
+ * packed board: the leftmost cell is the most significant nibble.
+ *
+ * rowSlides: The row after sliding left (low 16 bits) and after sliding
+ *            right (high 16 bits)
+ * rowRewards: The reward for merging the row's tiles. The same tiles merge
+ *             no matter which way the row slides, so one table serves
+ *             both directions.
+ * rowMoves: Whether sliding the row changes it, when sliding left (bit 0)
+ *           and when sliding right (bit 1)
+ *
+ * The tables are filled during static initialization, before main() runs.
+ */
+extern uint32_t rowSlides[NUM_ROWS];
+extern uint32_t rowRewards[NUM_ROWS];
+extern uint8_t rowMoves[NUM_ROWS];
+
+
+/**
+ * Transposes a packed board, so that the rows become columns and the
+ * columns become rows. Sliding the transposed board left or right is
+ * the same as sliding the original board up or down.
+ *
+ * :param board: Packed board to transpose
+ *
+ * :return: Transposed board
+ */
+inline uint64_t transposeBoard(uint64_t board)
+{
+    uint64_t a1 = board & 0xF0F00F0FF0F00F0FULL;
+    uint64_t a2 = board & 0x0000F0F00000F0F0ULL;
+    uint64_t a3 = board & 0x0F0F00000F0F0000ULL;
+    uint64_t a = a1 | (a2 << 12) | (a3 >> 12);
+
+    uint64_t b1 = a & 0xFF00FF0000FF00FFULL;
+    uint64_t b2 = a & 0x00FF00FF00000000ULL;
+    uint64_t b3 = a & 0x00000000FF00FF00ULL;
+    return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+
+/**
+ * Mirrors a packed board left to right, by reversing the four cells of 
+ * each row: first swap neighbouring cells, then swap the pairs.
+ *
+ * :param board: Packed board to mirror
+ *
+ * :return: Mirrored board
+ */
+inline uint64_t flipBoardHorizontal(uint64_t board)
+{
+    board = ((board & 0xF0F0F0F0F0F0F0F0ULL) >> 4) | ((board & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return ((board & 0xFF00FF00FF00FF00ULL) >> 8) | ((board & 0x00FF00FF00FF00FFULL) << 8);
+}
+
+
+/**
+ * Mirrors a packed board top to bottom, by reversing the order of its
+ * four 16-bit rows.
+ *
+ * :param board: Packed board to mirror
+ *
+ * :return: Mirrored board
+ */
+inline uint64_t flipBoardVertical(uint64_t board)
+{
+    board = (board >> 32) | (board << 32);
+    return ((board & 0xFFFF0000FFFF0000ULL) >> 16) | ((board & 0x0000FFFF0000FFFFULL) << 16);
+}
+
+
+/**
+ * Rotates a packed board by 90 degrees clockwise, so that the left
+ * column becomes the top row.
+ *
+ * :param board: Packed board to rotate
+ *
+ * :return: Rotated board
+ */
+inline uint64_t rotateBoard(uint64_t board)
+{
+    return flipBoardHorizontal(transposeBoard(board));
+}
+
+
+/**
+ * Slides every row of a packed board using the given half of rowSlides
+ * (0 for left, 16 for right), accumulating the merge rewards.
+ *
+ * :param board: Packed board to slide
+ * :param half: Bit offset of the wanted result within rowSlides
+ * :param reward: Reward for the move (return value)
+ *
+ * :return: Board after the slide
+ */
+inline uint64_t slideRows(uint64_t board, unsigned int half, unsigned int& reward)
+{
+    uint64_t result = 0;
+    reward = 0;
+
+    for (unsigned int shift = 0; shift < 64; shift += 16) {
+        unsigned int row = (board >> shift) & 0xFFFF;
+        result |= uint64_t((rowSlides[row] >> half) & 0xFFFF) << shift;
+        reward += rowRewards[row];
+    }
+
+    return result;
+}
+
+
+/**
+ * These functions slide a whole packed board in one direction and
+ * return the resulting board. The reward for the move is returned
+ * through the reward argument.
+ */
+inline uint64_t slideBoardLeft(uint64_t board, unsigned int& reward)
+{
+    return slideRows(board, 0, reward);
+}
+
+inline uint64_t slideBoardRight(uint64_t board, unsigned int& reward)
+{
+    return slideRows(board, 16, reward);
+}
+
+inline uint64_t slideBoardUp(uint64_t board, unsigned int& reward)
+{
+    return transposeBoard(slideRows(transposeBoard(board), 0, reward));
+}
+
+inline uint64_t slideBoardDown(uint64_t board, unsigned int& reward)
+{
+    return transposeBoard(slideRows(transposeBoard(board), 16, reward));
+}
+
+
+/**
+ * Finds which moves change a packed board, without building any of the
+ * afterstates. Each row (and each row of the transpose, for up and down)
+ * costs a single lookup into rowMoves.
+ *
+ * :param board: Packed board to check
+ *
+ * :return: Mask with bit 0 set if UP is legal, bit 1 for DOWN, bit 2 
+ *          for LEFT and bit 3 for RIGHT (the order of the Action enum)
+ */
+inline unsigned int legalBoardMoves(uint64_t board)
+{
+    uint64_t transposed = transposeBoard(board);
+    unsigned int rowFlags = 0;
+    unsigned int colFlags = 0;
+
+    for (unsigned int shift = 0; shift < 64; shift += 16) {
+        rowFlags |= rowMoves[(board >> shift) & 0xFFFF];
+        colFlags |= rowMoves[(transposed >> shift) & 0xFFFF];
+    }
+
+    return colFlags | (rowFlags << 2);
+}
+
+#endif
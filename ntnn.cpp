@@ -9,15 +9,566 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstdlib>
+#include <cstdint>
 #include <cmath>
+#include <limits>
+#include <alloca.h>
+#include <immintrin.h>
+#include <new>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace std;
 
-NTNN::NTNN(unsigned int num, unsigned int length, double alpha)
+/* Number of states whose weight indices the batched evaluate() computes
+ * before it starts loading their weights
+ */
+#define EVALUATE_CHUNK 16
+
+
+/**
+ * These structures describe how each type of dense table entry stores a
+ * weight. Sum is the type in which a state's entries are added up, 
+ * encode() turns a weight into an entry, and decode() turns an entry (or
+ * a sum of entries) back into a weight. Floating-point entries hold the
+ * weight itself, and fixed-point entries hold the weight times the scale
+ * factor, rounded and clamped to the range of the entry.
+ */
+template <typename Weight>
+struct WeightTraits
+{
+    typedef double Sum;
+
+    static Weight encode(double weight, double scale)
+    {
+        return weight;
+    }
+
+    static double decode(Sum entry, double scale)
+    {
+        return entry;
+    }
+};
+
+template <typename Weight>
+struct FixedWeightTraits
+{
+    typedef int64_t Sum;
+
+    static Weight encode(double weight, double scale)
+    {
+        double entry = round(weight*scale);
+        if (entry > numeric_limits<Weight>::max()) {
+            return numeric_limits<Weight>::max();
+        } else if (entry < numeric_limits<Weight>::min()) {
+            return numeric_limits<Weight>::min();
+        }
+        return Weight(entry);
+    }
+
+    static double decode(Sum entry, double scale)
+    {
+        return double(entry) / scale;
+    }
+};
+
+template <>
+struct WeightTraits<int16_t> : FixedWeightTraits<int16_t> {};
+
+template <>
+struct WeightTraits<int32_t> : FixedWeightTraits<int32_t> {};
+
+
+/* Identification of binary agent files (see saveBinary()). The version
+ * changes whenever the layout of the files changes.
+ */
+#define AGENT_FILE_MAGIC "NTNNBIN"
+#define DELTA_FILE_MAGIC "NTNNDLT"
+#define AGENT_FILE_VERSION 2
+
+/* Alignment of the tables within a binary agent file, which lets them be
+ * mapped on systems with pages of up to 64 kB. The tables are also 
+ * written in blocks of this size, and blocks of zeros are skipped.
+ */
+#define AGENT_FILE_ALIGNMENT 65536
+
+/* Size of the blocks of the dense tables whose changes are tracked, and
+ * which delta files hold (see saveDelta())
+ */
+#define DELTA_BLOCK_SIZE 4096
+
+/**
+ * This structure is the header at the start of a binary agent file. It is
+ * followed by the placement layout (the table of each placement, then the
+ * bit offsets of each placement's cells, all as uint32_t), and then, at
+ * tablesOffset, by the dense tables exactly as they are laid out in 
+ * memory. The checksum covers the layout, and the offset and contents of
+ * every block of the tables which is not all zeros, so that checking a
+ * file can skip its holes. The base id identifies the file to the delta
+ * files which build on it.
+ */
+struct AgentFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t gridSize;
+    uint32_t numTuples;
+    uint32_t tupleLength;
+    uint32_t numPlacements;
+    uint32_t weightType;
+    double weightScale;
+    double initialWeight;
+    uint64_t tableSize;
+    uint64_t tablesOffset;
+    uint64_t tablesBytes;
+    uint64_t baseId;
+    uint64_t checksum;
+};
+
+
+/**
+ * This structure is the header of a delta file, which holds the blocks of
+ * the dense tables that changed after the base file (with the given base
+ * id) or the previous delta file was saved. Delta file k of an agent file
+ * is named <agent file>.delta<k>, and its sequence number is k. The header
+ * is followed by numBlocks records: the offset of a block within the 
+ * tables (as a uint64_t), then the block itself, which is blockSize bytes
+ * long unless it is the last block of the tables. The checksum covers the
+ * records.
+ */
+struct DeltaFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t sequence;
+    uint64_t baseId;
+    uint64_t tablesBytes;
+    uint64_t blockSize;
+    uint64_t numBlocks;
+    uint64_t checksum;
+};
+
+/**
+ * Adds the given bytes to a running FNV-1a style checksum, a 64-bit word
+ * at a time so that checking a large file takes little time.
+ */
+static uint64_t checksumBytes(const void* data, size_t bytes, uint64_t checksum)
+{
+    const unsigned char* next = static_cast<const unsigned char*>(data);
+
+    for (; bytes >= 8; bytes -= 8, next += 8) {
+        uint64_t word;
+        memcpy(&word, next, 8);
+        checksum = (checksum ^ word) * 0x100000001b3ull;
+    }
+    for (; bytes > 0; --bytes, ++next) {
+        checksum = (checksum ^ *next) * 0x100000001b3ull;
+    }
+
+    return checksum;
+}
+
+
+/**
+ * Checks whether the given bytes are all zero.
+ */
+static bool isZero(const char* data, size_t bytes)
+{
+    /* Every byte is zero if the first one is, and each equals the next */
+    return (bytes == 0) || ((data[0] == 0) && (memcmp(data, data + 1, bytes - 1) == 0));
+}
+
+
+/**
+ * Adds a block of the dense tables, which starts at the given offset 
+ * within the tables, to the checksum of a binary agent file. Blocks of
+ * zeros are left out.
+ */
+static uint64_t checksumBlock(const char* tables, size_t offset, size_t bytes, uint64_t checksum)
+{
+    if (isZero(tables + offset, bytes)) {
+        return checksum;
+    }
+
+    uint64_t blockOffset = offset;
+    checksum = checksumBytes(&blockOffset, sizeof(blockOffset), checksum);
+    return checksumBytes(tables + offset, bytes, checksum);
+}
+
+
+/**
+ * Writes all of the given bytes to a file, at the current position.
+ */
+static bool writeBytes(int fd, const void* data, size_t bytes)
+{
+    const char* next = static_cast<const char*>(data);
+
+    while (bytes > 0) {
+        ssize_t written = write(fd, next, bytes);
+        if (written < 0) {
+            return false;
+        }
+        next += written;
+        bytes -= written;
+    }
+
+    return true;
+}
+
+
+/**
+ * Builds the name of delta file k of the given agent file.
+ */
+static string deltaFileName(const string& agentFile, uint32_t sequence)
+{
+    return agentFile + ".delta" + to_string(sequence);
+}
+
+
+/**
+ * Removes the delta files of the given agent file, which a new base file
+ * replaces.
+ */
+static void removeDeltas(const string& agentFile)
+{
+    for (uint32_t sequence = 1; unlink(deltaFileName(agentFile, sequence).c_str()) == 0; ++sequence) {
+    }
+}
+
+
+/**
+ * Comes up with the id of a new base file. The id only has to differ 
+ * from the ids of the earlier base files of an agent.
+ */
+static uint64_t newBaseId()
+{
+    random_device source;
+    uint64_t id = (uint64_t(source()) << 32) ^ source() ^ uint64_t(time(nullptr));
+    return (id != 0) ? id : 1;
+}
+
+
+/**
+ * Copies dense tables over another copy of them. Only the blocks which
+ * hold data are copied, so that the untrained parts of the tables take up
+ * no memory in the copy either.
+ */
+static void copyTables(char* copy, const char* tables, size_t tablesBytes)
+{
+    for (size_t offset = 0; offset < tablesBytes; offset += AGENT_FILE_ALIGNMENT) {
+        size_t bytes = min<size_t>(AGENT_FILE_ALIGNMENT, tablesBytes - offset);
+        if (!isZero(tables + offset, bytes)) {
+            memcpy(copy + offset, tables + offset, bytes);
+        } else if (!isZero(copy + offset, bytes)) {
+            memset(copy + offset, 0, bytes);
+        }
+    }
+}
+
+
+/**
+ * Writes a binary agent file, given its header and placement layout (the
+ * prefix, whose checksum is filled in here) and its tables. A new file is
+ * written and renamed over the old one, so that the old file stays whole
+ * until the new one is, and so that a network which mapped the old file
+ * (see NTNN::loadBinary()) keeps its tables.
+ */
+static bool writeAgentFile(const string& agentFile, const vector<char>& prefix, const char* tables)
+{
+    AgentFileHeader header;
+    memcpy(&header, prefix.data(), sizeof(header));
+
+    const char* layout = prefix.data() + sizeof(header);
+    size_t layoutBytes = prefix.size() - sizeof(header);
+    size_t tablesBytes = header.tablesBytes;
+    header.checksum = checksumBytes(layout, layoutBytes, 0xcbf29ce484222325ull);
+
+    string tmpFile = agentFile + ".tmp";
+    int fd = open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool written = (lseek(fd, header.tablesOffset, SEEK_SET) >= 0);
+
+    /* Most of a table is usually never trained, so leave holes in the 
+     * file where the blocks are all zeros.
+     */
+    for (size_t offset = 0; written && (offset < tablesBytes); offset += AGENT_FILE_ALIGNMENT) {
+        size_t bytes = min<size_t>(AGENT_FILE_ALIGNMENT, tablesBytes - offset);
+        if (isZero(tables + offset, bytes)) {
+            written = lseek(fd, bytes, SEEK_CUR) >= 0;
+        } else {
+            header.checksum = checksumBlock(tables, offset, bytes, header.checksum);
+            written = writeBytes(fd, tables + offset, bytes);
+        }
+    }
+
+    /* The header goes in last, once the checksum is known */
+    written = written && (ftruncate(fd, header.tablesOffset + tablesBytes) == 0) && 
+              (lseek(fd, 0, SEEK_SET) == 0) && writeBytes(fd, &header, sizeof(header)) && 
+              writeBytes(fd, layout, layoutBytes) && (fsync(fd) == 0);
+    written = (close(fd) == 0) && written;
+
+    if (!written || (rename(tmpFile.c_str(), agentFile.c_str()) != 0)) {
+        unlink(tmpFile.c_str());
+        return false;
+    }
+
+    /* The deltas of the old base file are now out of date */
+    removeDeltas(agentFile);
+    return true;
+}
+
+
+/**
+ * Writes a delta file of the given agent file, given its header (whose
+ * number of blocks and checksum are filled in here), the offsets of its
+ * blocks, and the blocks themselves, one after the other.
+ */
+static bool writeDeltaFile(const string& agentFile, const vector<char>& prefix, 
+                           const vector<uint64_t>& blockOffsets, const vector<char>& blocks)
+{
+    DeltaFileHeader header;
+    memcpy(&header, prefix.data(), sizeof(header));
+    header.numBlocks = blockOffsets.size();
+    header.checksum = 0xcbf29ce484222325ull;
+
+    string deltaFile = deltaFileName(agentFile, header.sequence);
+    string tmpFile = deltaFile + ".tmp";
+
+    /* A delta which follows this one is left over from before, and must
+     * not be loaded on top of it
+     */
+    unlink(deltaFileName(agentFile, header.sequence + 1).c_str());
+
+    int fd = open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool written = (lseek(fd, sizeof(header), SEEK_SET) >= 0);
+    const char* block = blocks.data();
+
+    for (size_t i = 0; written && (i < blockOffsets.size()); ++i) {
+        uint64_t offset = blockOffsets[i];
+        size_t bytes = min<size_t>(header.blockSize, header.tablesBytes - offset);
+
+        header.checksum = checksumBytes(&offset, sizeof(offset), header.checksum);
+        header.checksum = checksumBytes(block, bytes, header.checksum);
+        written = writeBytes(fd, &offset, sizeof(offset)) && writeBytes(fd, block, bytes);
+        block += bytes;
+    }
+
+    written = written && (lseek(fd, 0, SEEK_SET) == 0) && writeBytes(fd, &header, sizeof(header)) && 
+              (fsync(fd) == 0);
+    written = (close(fd) == 0) && written;
+
+    if (!written || (rename(tmpFile.c_str(), deltaFile.c_str()) != 0)) {
+        unlink(tmpFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * Reads a whole file into memory.
+ */
+static bool readFile(const string& fileName, vector<char>& data)
+{
+    ifstream file(fileName, ios::in | ios::binary | ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    data.resize(file.tellg());
+    file.seekg(0);
+    return bool(file.read(data.data(), data.size()));
+}
+
+
+/**
+ * Checks (once) whether the CPU we are running on supports AVX2.
+ */
+static bool cpuSupportsAVX2()
+{
+    static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return supported;
+}
+
+
+/**
+ * Computes the weight indices, including the offsets of their tables, of
+ * the count placements of a network on a 4x4 board, eight at a time. Each
+ * cell's exponent is shifted out of the low or the high 32 bits of the 
+ * packed board. The indices are stored in indices, which has room for
+ * count rounded up to a multiple of eight entries.
+ */
+__attribute__((target("avx2")))
+static void gatherIndicesAVX2(uint64_t board, const GatherLayout& layout, unsigned int count,
+                              unsigned int length, int32_t* indices)
+{
+    __m256i low = _mm256_set1_epi32(uint32_t(board));
+    __m256i high = _mm256_set1_epi32(uint32_t(board >> 32));
+    __m256i nibble = _mm256_set1_epi32(0xF);
+
+    for (unsigned int first = 0; first < count; first += 8) {
+        __m256i index = _mm256_loadu_si256((const __m256i*) &layout.bases[first]);
+
+        for (unsigned int i = 0; i < length; ++i) {
+            unsigned int entry = i*layout.stride + first;
+            __m256i halves = _mm256_loadu_si256((const __m256i*) &layout.halves[entry]);
+            __m256i shifts = _mm256_loadu_si256((const __m256i*) &layout.shifts[entry]);
+
+            __m256i exponents = _mm256_srlv_epi32(_mm256_blendv_epi8(low, high, halves), shifts);
+            exponents = _mm256_and_si256(exponents, nibble);
+            index = _mm256_add_epi32(index, _mm256_sll_epi32(exponents, _mm_cvtsi32_si128(4*i)));
+        }
+
+        _mm256_storeu_si256((__m256i*) &indices[first], index);
+    }
+}
+
+
+/**
+ * Returns a mask of the lanes which hold one of the count placements, 
+ * for the eight placements starting at placement first.
+ */
+__attribute__((target("avx2")))
+static inline __m256i validLanesAVX2(unsigned int count, unsigned int first)
+{
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(count - first), lanes);
+}
+
+
+/**
+ * Adds up the four lanes of a vector of doubles.
+ */
+__attribute__((target("avx2")))
+static inline double sumLanesAVX2(__m256d sum)
+{
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+
+/**
+ * These kernels gather and add up the weights at the count indices given
+ * by gatherIndicesAVX2(), for each type of dense table they support. 
+ * Floats are added up as doubles, and fixed-point weights as 64-bit 
+ * integers, like the scalar code does.
+ */
+__attribute__((target("avx2")))
+static double gatherDoublesAVX2(const double* tables, const int32_t* indices, unsigned int count)
+{
+    __m256d sum = _mm256_setzero_pd();
+
+    for (unsigned int first = 0; first < count; first += 8) {
+        __m256i index = _mm256_loadu_si256((const __m256i*) &indices[first]);
+        __m256i valid = validLanesAVX2(count, first);
+
+        /* Doubles are gathered four at a time, with 64-bit lane masks */
+        __m256d validLow = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(valid)));
+        __m256d validHigh = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(valid, 1)));
+
+        sum = _mm256_add_pd(sum, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), tables, 
+                                 _mm256_castsi256_si128(index), validLow, 8));
+        sum = _mm256_add_pd(sum, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), tables, 
+                                 _mm256_extracti128_si256(index, 1), validHigh, 8));
+    }
+
+    return sumLanesAVX2(sum);
+}
+
+__attribute__((target("avx2")))
+static double gatherFloatsAVX2(const float* tables, const int32_t* indices, unsigned int count)
+{
+    __m256d sum = _mm256_setzero_pd();
+
+    for (unsigned int first = 0; first < count; first += 8) {
+        __m256i index = _mm256_loadu_si256((const __m256i*) &indices[first]);
+        __m256 valid = _mm256_castsi256_ps(validLanesAVX2(count, first));
+        __m256 weights = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), tables, index, valid, 4);
+
+        sum = _mm256_add_pd(sum, _mm256_cvtps_pd(_mm256_castps256_ps128(weights)));
+        sum = _mm256_add_pd(sum, _mm256_cvtps_pd(_mm256_extractf128_ps(weights, 1)));
+    }
+
+    return sumLanesAVX2(sum);
+}
+
+__attribute__((target("avx2")))
+static int64_t gatherFixed32AVX2(const int32_t* tables, const int32_t* indices, unsigned int count)
+{
+    __m256i sum = _mm256_setzero_si256();
+
+    for (unsigned int first = 0; first < count; first += 8) {
+        __m256i index = _mm256_loadu_si256((const __m256i*) &indices[first]);
+        __m256i valid = validLanesAVX2(count, first);
+        __m256i weights = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*) tables, 
+                                                      index, valid, 4);
+
+        sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(weights)));
+        sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(weights, 1)));
+    }
+
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*) lanes, sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+
+
+template <unsigned int N>
+BasicNTNN<N>::BasicNTNN(unsigned int num, unsigned int length, double alpha)
+    : BasicNTNN(num, length, alpha, false)
+{
+}
+
+
+template <unsigned int N>
+BasicNTNN<N>::BasicNTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights)
+    : BasicNTNN(num, length, alpha, initializeWeights, (length <= MAX_DENSE_TUPLE_LENGTH) ? DENSE : HASHED)
+{
+}
+
+
+template <unsigned int N>
+BasicNTNN<N>::BasicNTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights, WeightStorage storage)
+    : BasicNTNN(num, length, alpha, initializeWeights, storage, 
+                (length <= MAX_DOUBLE_TUPLE_LENGTH) ? DOUBLE_WEIGHTS : FLOAT_WEIGHTS)
+{
+}
+
+
+template <unsigned int N>
+BasicNTNN<N>::BasicNTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights, 
+                        WeightStorage storage, WeightType weightType)
+    : BasicNTNN(num, length, alpha, initializeWeights, storage, weightType,
+                (weightType == FIXED16_WEIGHTS) ? FIXED16_SCALE : FIXED32_SCALE)
+{
+}
+
+
+template <unsigned int N>
+BasicNTNN<N>::BasicNTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights, 
+                        WeightStorage storage, WeightType weightType, double weightScale)
     : numTuples{num},
       tupleLength{length},
       alpha{alpha},
-      initializeWeights{false}
+      initializeWeights{initializeWeights},
+      storage{storage},
+      weightType{weightType},
+      weightScale{weightScale}
 {
     /* Declare the array of pointers for the tuples */
     tuples = new unsigned int*[numTuples];
@@ -27,132 +578,740 @@ NTNN::NTNN(unsigned int num, unsigned int length, double alpha)
         tuples[i] = new unsigned int[tupleLength];
     }
 
-    /* Dynamically create the array of hashmaps for the weights */
-    weights = new unordered_map<unsigned int, double>[numTuples];
+    /* Make room for the placements of every tuple in all of its
+     * symmetric positions, in case the tuples are symmetric.
+     */
+    placementTables = new unsigned int[NUM_SYMMETRIES*numTuples];
+    cellOffsets = new unsigned int[NUM_SYMMETRIES*numTuples*tupleLength];
+
+    switch (storage) {
+
+    case DENSE:
+    {
+        size_t weightSize = sizeof(double);
+        switch (weightType) {
+        case DOUBLE_WEIGHTS:  weightSize = sizeof(double); break;
+        case FLOAT_WEIGHTS:   weightSize = sizeof(float); break;
+        case FIXED16_WEIGHTS: weightSize = sizeof(int16_t); break;
+        case FIXED32_WEIGHTS: weightSize = sizeof(int32_t); break;
+        }
+        tableSize = size_t(1) << (4*tupleLength);
+        denseBytes = numTuples*tableSize*weightSize;
+
+        /* Map all of the tables as one block. Without MAP_NORESERVE, the 
+         * system would set aside memory for the whole block up front.
+         */
+        void* block = mmap(nullptr, denseBytes, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (block == MAP_FAILED) {
+            throw bad_alloc();
+        }
+        denseWeights = block;
+
+        size_t numBlocks = (denseBytes + DELTA_BLOCK_SIZE - 1) / DELTA_BLOCK_SIZE;
+        dirtyBlocks.assign((numBlocks + 63) / 64, 0);
+        break;
+    }
+
+    case HASHED:
+        /* Dynamically create the array of hashmaps for the weights */
+        weights = new unordered_map<size_t, double>[numTuples];
+        break;
+    }
+
+    /* The gather kernel reads a single 64-bit board word, and addresses
+     * the tables with 32-bit indices. There is no kernel for 16-bit
+     * weights, which cannot be gathered on their own.
+     */
+    gatherEvaluate = (storage == DENSE) && (BasicState<N>::BOARD_WORDS == 1) &&
+                     (weightType != FIXED16_WEIGHTS) && (numTuples*tableSize <= INT32_MAX) && 
+                     cpuSupportsAVX2();
+
+    if (gatherEvaluate) {
+        gather.stride = (NUM_SYMMETRIES*numTuples + 7) / 8 * 8;
+        gather.shifts = new uint32_t[gather.stride*tupleLength]();
+        gather.halves = new uint32_t[gather.stride*tupleLength]();
+        gather.bases = new int32_t[gather.stride]();
+    }
+}
+
+
+template <unsigned int N>
+BasicNTNN<N>::~BasicNTNN()
+{
+    for (int i = 0; i < numTuples; ++i) {
+        delete[] tuples[i];
+    }
+
+    delete[] tuples;
+    delete[] placementTables;
+    delete[] cellOffsets;
+    delete[] gather.shifts;
+    delete[] gather.halves;
+    delete[] gather.bases;
+    delete[] weights;
+
+    if (denseWeights != nullptr) {
+        munmap(denseWeights, denseBytes);
+    }
+}
+
+
+template <unsigned int N>
+bool BasicNTNN<N>::addTuple(unsigned int* tuple, unsigned int length)
+{   
+    /* Check if the given tuple has the proper length */
+    if (length != tupleLength) {
+        return false;
+    }
+
+    /* If the tuple has the right size, check if we have room for it. */
+    if (currentNumTuples == numTuples) {
+        return false;
+    }
+
+    /* If we have room, add the tuple to the tuples array */
+    for (unsigned int i = 0; i < length; ++i) {
+        tuples[currentNumTuples][i] = tuple[i];
+    }
+
+    addPlacement(tuple, currentNumTuples);
+
+    currentNumTuples++;
+    return true;
+}
+
+
+/**
+ * Finds the cell of an N x N board that the given cell moves to under
+ * one of the board's symmetries, exactly as BasicState::applySymmetry()
+ * moves the tiles.
+ */
+template <unsigned int N>
+static unsigned int transformCell(unsigned int cell, unsigned int symmetry)
+{
+    unsigned int row = cell / N;
+    unsigned int col = cell % N;
+
+    /* Rotate clockwise as many times as needed, then mirror */
+    for (unsigned int k = 0; k < (symmetry & 3u); ++k) {
+        unsigned int temp = row;
+        row = col;
+        col = N - 1 - temp;
+    }
+
+    if (symmetry & 4u) {
+        col = N - 1 - col;
+    }
+
+    return row*N + col;
+}
+
+
+template <unsigned int N>
+bool BasicNTNN<N>::addSymmetricTuple(unsigned int* tuple, unsigned int length)
+{
+    /* Check if the given tuple has the proper length */
+    if (length != tupleLength) {
+        return false;
+    }
+
+    /* If the tuple has the right size, check if we have room for it. */
+    if (currentNumTuples == numTuples) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < length; ++i) {
+        tuples[currentNumTuples][i] = tuple[i];
+    }
+
+    /* Place the tuple in each of its symmetric positions. A tuple which
+     * some symmetry maps onto itself (cell for cell) has fewer than 
+     * NUM_SYMMETRIES distinct placements, and each is only added once.
+     */
+    unsigned int* cells = static_cast<unsigned int*>(alloca(length*sizeof(unsigned int)));
+    unsigned int firstPlacement = numPlacements;
+
+    for (unsigned int k = 0; k < NUM_SYMMETRIES; ++k) {
+
+        for (unsigned int i = 0; i < length; ++i) {
+            cells[i] = transformCell<N>(tuple[i], k);
+        }
+
+        bool duplicate = false;
+        for (unsigned int p = firstPlacement; (p < numPlacements) && !duplicate; ++p) {
+            duplicate = true;
+            for (unsigned int i = 0; (i < length) && duplicate; ++i) {
+                duplicate = (cellOffsets[p*tupleLength + i] == getCellOffset(cells[i]));
+            }
+        }
+
+        if (!duplicate) {
+            addPlacement(cells, currentNumTuples);
+        }
+    }
+
+    currentNumTuples++;
+    return true;
+}
+
+
+template <unsigned int N>
+void BasicNTNN<N>::addPlacement(const unsigned int* cells, unsigned int table)
+{
+    unsigned int* offsets = &cellOffsets[numPlacements*tupleLength];
+
+    for (unsigned int i = 0; i < tupleLength; ++i) {
+        offsets[i] = getCellOffset(cells[i]);
+    }
+
+    if (gather.bases != nullptr) {
+        for (unsigned int i = 0; i < tupleLength; ++i) {
+            gather.shifts[i*gather.stride + numPlacements] = offsets[i] % 32;
+            gather.halves[i*gather.stride + numPlacements] = (offsets[i] >= 32) ? 0xFFFFFFFF : 0;
+        }
+        gather.bases[numPlacements] = table*tableSize;
+    }
+
+    placementTables[numPlacements] = table;
+    numPlacements++;
+}
+
+
+template <unsigned int N>
+unsigned int BasicNTNN<N>::getCellOffset(unsigned int cell)
+{
+    /* Cell i of the board is held in bits 60 - 4*(i % 16) and up of word
+     * i / 16, which we store as a single bit offset into the board's words.
+     */
+    return 64*(cell / 16) + 4*(15 - cell % 16);
+}
+
+
+template <unsigned int N>
+unsigned int BasicNTNN<N>::getNumTuples() const
+{
+    return currentNumTuples;
+}
+
+
+template <unsigned int N>
+unsigned int BasicNTNN<N>::getNumPlacements() const
+{
+    return numPlacements;
+}
+
+
+template <unsigned int N>
+unsigned int BasicNTNN<N>::getPlacementTuple(unsigned int placement) const
+{
+    return placementTables[placement];
+}
+
+
+template <unsigned int N>
+double BasicNTNN<N>::getAlpha() const
+{
+    return alpha;
+}
+
+
+template <unsigned int N>
+void BasicNTNN<N>::setMaterializePolicy(MaterializePolicy policy)
+{
+    materializePolicy = policy;
+}
+
+
+template <unsigned int N>
+inline size_t BasicNTNN<N>::getIndex(const uint64_t* words, unsigned int placement) const
+{
+    const unsigned int* offsets = &cellOffsets[placement*tupleLength];
+    size_t index = 0;
+
+    for (unsigned int i = 0; i < tupleLength; ++i) {
+        size_t exponent = (words[offsets[i] / 64] >> (offsets[i] % 64)) & 0xF;
+        index |= exponent << (4*i);
+    }
+
+    return index;
+}
+
+
+template <unsigned int N>
+void BasicNTNN<N>::getIndices(const BasicState<N>& state, size_t* indices) const
+{
+    const uint64_t* words = state.getBoardWords();
+
+    for (unsigned int i = 0; i < numPlacements; ++i) {
+        indices[i] = getIndex(words, i);
+    }
+}
+
+
+template <unsigned int N>
+size_t BasicNTNN<N>::getMemoryBudget() const
+{
+    return denseBytes;
+}
+
+
+/**
+ * Stores the value of the k-th state evaluated by a batched evaluate(), 
+ * either in the array of values or in the state's evaluation.
+ */
+static inline void storeValue(double value, unsigned int k, double* values, Evaluation* evaluations)
+{
+    if (evaluations) {
+        evaluations[k].value = value;
+    } else {
+        values[k] = value;
+    }
+}
+
+
+template <unsigned int N>
+template <typename Weight>
+void BasicNTNN<N>::evaluateDense(const BasicState<N>* states, unsigned int count, double* values, 
+                                 Evaluation* evaluations) const
+{
+    const Weight* tables = static_cast<const Weight*>(denseWeights);
+    size_t* entries = static_cast<size_t*>(alloca(EVALUATE_CHUNK*numPlacements*sizeof(size_t)));
+
+    /* The tables hold each weight minus its initial value. Symmetric
+     * placements of a tuple read the same table.
+     */
+    double initialValue = initializeWeights ? numPlacements*INITIAL_WEIGHTS : 0.0;
+
+    for (unsigned int first = 0; first < count; first += EVALUATE_CHUNK) {
+        unsigned int chunk = (count - first < EVALUATE_CHUNK) ? count - first : EVALUATE_CHUNK;
+
+        /* Work out every table entry of the chunk first, so that the 
+         * loads below are independent and their cache misses overlap.
+         */
+        for (unsigned int k = 0; k < chunk; ++k) {
+            const uint64_t* words = states[first + k].getBoardWords();
+            for (unsigned int i = 0; i < numPlacements; ++i) {
+                entries[k*numPlacements + i] = getIndex(words, i);
+            }
+            if (evaluations) {
+                evaluations[first + k].indices.assign(&entries[k*numPlacements], 
+                                                      &entries[(k + 1)*numPlacements]);
+            }
+            for (unsigned int i = 0; i < numPlacements; ++i) {
+                entries[k*numPlacements + i] += placementTables[i]*tableSize;
+            }
+        }
+
+        for (unsigned int k = 0; k < chunk; ++k) {
+            typename WeightTraits<Weight>::Sum sum = 0;
+            for (unsigned int i = 0; i < numPlacements; ++i) {
+                sum += tables[entries[k*numPlacements + i]];
+            }
+            storeValue(initialValue + WeightTraits<Weight>::decode(sum, weightScale), first + k, 
+                       values, evaluations);
+        }
+    }
+}
+
+
+template <unsigned int N>
+template <typename Weight>
+double BasicNTNN<N>::sumDense(const size_t* indices) const
+{
+    const Weight* tables = static_cast<const Weight*>(denseWeights);
+    typename WeightTraits<Weight>::Sum sum = 0;
+    double value = 0.0;
+
+    if (initializeWeights) {
+        value = numPlacements*INITIAL_WEIGHTS;
+    }
+
+    for (unsigned int i = 0; i < numPlacements; ++i) {
+        sum += tables[placementTables[i]*tableSize + indices[i]];
+    }
+
+    return value + WeightTraits<Weight>::decode(sum, weightScale);
+}
+
+
+template <unsigned int N>
+inline void BasicNTNN<N>::markDirty(size_t offset)
+{
+    size_t block = offset / DELTA_BLOCK_SIZE;
+    uint64_t* word = &dirtyBlocks[block / 64];
+    uint64_t bit = uint64_t(1) << (block % 64);
+
+    /* Other threads may be training the network too (see train()), so 
+     * the bit is set atomically, but only when it is not set yet, which
+     * is rare once training is under way.
+     */
+    if (!(__atomic_load_n(word, __ATOMIC_RELAXED) & bit)) {
+        __atomic_fetch_or(word, bit, __ATOMIC_RELAXED);
+    }
+}
+
+
+template <unsigned int N>
+template <typename Weight>
+inline void BasicNTNN<N>::updateDenseEntry(size_t entry, double weightChange)
+{
+    Weight* weight = static_cast<Weight*>(denseWeights) + entry;
+
+    /* The weight is read and written with relaxed atomic accesses, which
+     * are plain loads and stores, so that threads training the network at
+     * the same time never tear a weight. When two threads update the same
+     * weight at once, one of the updates may be lost.
+     */
+    Weight stored;
+    __atomic_load(weight, &stored, __ATOMIC_RELAXED);
+
+    double value = WeightTraits<Weight>::decode(stored, weightScale);
+    Weight updated = WeightTraits<Weight>::encode(value + weightChange, weightScale);
+    __atomic_store(weight, &updated, __ATOMIC_RELAXED);
+    markDirty(entry*sizeof(Weight));
+}
+
+
+template <unsigned int N>
+template <typename Weight>
+void BasicNTNN<N>::updateDense(const size_t* indices, double weightChange)
+{
+    for (unsigned int i = 0; i < numPlacements; ++i) {
+        updateDenseEntry<Weight>(placementTables[i]*tableSize + indices[i], weightChange);
+    }
+}
+
+
+
+template <unsigned int N>
+void BasicNTNN<N>::evaluateGather(const BasicState<N>* states, unsigned int count, double* values, 
+                                  Evaluation* evaluations) const
+{
+    int32_t* indices = static_cast<int32_t*>(alloca(EVALUATE_CHUNK*gather.stride*sizeof(int32_t)));
+    double initialValue = initializeWeights ? numPlacements*INITIAL_WEIGHTS : 0.0;
+
+    for (unsigned int first = 0; first < count; first += EVALUATE_CHUNK) {
+        unsigned int chunk = (count - first < EVALUATE_CHUNK) ? count - first : EVALUATE_CHUNK;
+
+        /* Compute the indices of the whole chunk before gathering */
+        for (unsigned int k = 0; k < chunk; ++k) {
+            gatherIndicesAVX2(states[first + k].getBoard(), gather, numPlacements, tupleLength, 
+                              &indices[k*gather.stride]);
+        }
+
+        for (unsigned int k = 0; k < chunk; ++k) {
+            const int32_t* stateIndices = &indices[k*gather.stride];
+            double value = 0.0;
+
+            /* Take the offsets of the tables back out of the indices */
+            if (evaluations) {
+                vector<size_t>& kept = evaluations[first + k].indices;
+                kept.resize(numPlacements);
+                for (unsigned int i = 0; i < numPlacements; ++i) {
+                    kept[i] = stateIndices[i] - gather.bases[i];
+                }
+            }
+
+            switch (weightType) {
+            case DOUBLE_WEIGHTS:
+                value = gatherDoublesAVX2(static_cast<const double*>(denseWeights), stateIndices, numPlacements);
+                break;
+            case FLOAT_WEIGHTS:
+                value = gatherFloatsAVX2(static_cast<const float*>(denseWeights), stateIndices, numPlacements);
+                break;
+            case FIXED32_WEIGHTS:
+                value = WeightTraits<int32_t>::decode(gatherFixed32AVX2(static_cast<const int32_t*>(denseWeights), 
+                                                      stateIndices, numPlacements), weightScale);
+                break;
+            case FIXED16_WEIGHTS:
+                /* Never chosen, see the constructor */
+                break;
+            }
+
+            storeValue(initialValue + value, first + k, values, evaluations);
+        }
+    }
+}
+
+
+template <unsigned int N>
+double BasicNTNN<N>::getDenseEntry(size_t i) const
+{
+    switch (weightType) {
+    case DOUBLE_WEIGHTS:
+        return static_cast<const double*>(denseWeights)[i];
+    case FLOAT_WEIGHTS:
+        return static_cast<const float*>(denseWeights)[i];
+    case FIXED16_WEIGHTS:
+        return WeightTraits<int16_t>::decode(static_cast<const int16_t*>(denseWeights)[i], weightScale);
+    case FIXED32_WEIGHTS:
+        return WeightTraits<int32_t>::decode(static_cast<const int32_t*>(denseWeights)[i], weightScale);
+    }
+
+    return 0.0;
+}
+
+
+template <unsigned int N>
+void BasicNTNN<N>::setDenseEntry(size_t i, double value)
+{
+    switch (weightType) {
+    case DOUBLE_WEIGHTS:
+        static_cast<double*>(denseWeights)[i] = value;
+        markDirty(i*sizeof(double));
+        break;
+    case FLOAT_WEIGHTS:
+        static_cast<float*>(denseWeights)[i] = value;
+        markDirty(i*sizeof(float));
+        break;
+    case FIXED16_WEIGHTS:
+        static_cast<int16_t*>(denseWeights)[i] = WeightTraits<int16_t>::encode(value, weightScale);
+        markDirty(i*sizeof(int16_t));
+        break;
+    case FIXED32_WEIGHTS:
+        static_cast<int32_t*>(denseWeights)[i] = WeightTraits<int32_t>::encode(value, weightScale);
+        markDirty(i*sizeof(int32_t));
+        break;
+    }
+}
+
+
+template <unsigned int N>
+double BasicNTNN<N>::evaluate(const BasicState<N>& state) const
+{
+    double value = 0.0;
+    evaluate(&state, 1, &value);
+    return value;
 }
 
 
-NTNN::NTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights)
-    : numTuples{num},
-      tupleLength{length},
-      alpha{alpha},
-      initializeWeights{initializeWeights}
+template <unsigned int N>
+void BasicNTNN<N>::evaluate(const BasicState<N>* states, unsigned int count, double* values) const
 {
-    /* Declare the array of pointers for the tuples */
-    tuples = new unsigned int*[numTuples];
+    evaluateStates(states, count, values, nullptr);
+}
 
-    /* Create the arrays for each individual tuple */
-    for (int i = 0; i < numTuples; ++i) {
-        tuples[i] = new unsigned int[tupleLength];
-    }
 
-    /* Dynamically create the array of hashmaps for the weights */
-    weights = new unordered_map<unsigned int, double>[numTuples];
+template <unsigned int N>
+void BasicNTNN<N>::evaluate(const BasicState<N>* states, unsigned int count, Evaluation* evaluations) const
+{
+    evaluateStates(states, count, nullptr, evaluations);
 }
 
 
-NTNN::~NTNN()
+template <unsigned int N>
+bool BasicNTNN<N>::setEvaluateKernel(const char* kernel)
 {
-    for (int i = 0; i < numTuples; ++i) {
-        delete[] tuples[i];
+    if (strcmp(kernel, "avx2") == 0) {
+        if (gather.bases == nullptr) {
+            return false;
+        }
+        gatherEvaluate = true;
+    } else if (strcmp(kernel, "scalar") == 0) {
+        gatherEvaluate = false;
+    } else {
+        return false;
     }
 
-    delete[] tuples;
-    delete[] weights;
+    return true;
 }
 
 
-bool NTNN::addTuple(unsigned int* tuple, unsigned int length)
-{   
-    /* Check if the given tuple has the proper length */
-    if (length != tupleLength) {
-        return false;
-    }
+template <unsigned int N>
+void BasicNTNN<N>::evaluateStates(const BasicState<N>* states, unsigned int count, double* values, 
+                                  Evaluation* evaluations) const
+{
+    switch (storage) {
 
-    /* If the tuple has the right size, check if we have room for it. */
-    if (currentNumTuples == numTuples) {
-        return false;
-    }
+    case DENSE:
+        if (gatherEvaluate) {
+            evaluateGather(states, count, values, evaluations);
+            break;
+        }
 
-    /* If we have room, add the tuple to the tuples array */
-    for (unsigned int i = 0; i < length; ++i) {
-        tuples[currentNumTuples][i] = tuple[i];
-    }
+        switch (weightType) {
+        case DOUBLE_WEIGHTS:  evaluateDense<double>(states, count, values, evaluations); break;
+        case FLOAT_WEIGHTS:   evaluateDense<float>(states, count, values, evaluations); break;
+        case FIXED16_WEIGHTS: evaluateDense<int16_t>(states, count, values, evaluations); break;
+        case FIXED32_WEIGHTS: evaluateDense<int32_t>(states, count, values, evaluations); break;
+        }
+        break;
 
-    currentNumTuples++;
-    return true;
+    case HASHED:
+        for (unsigned int k = 0; k < count; ++k) {
+            const uint64_t* words = states[k].getBoardWords();
+            double value = 0.0;
+
+            if (evaluations) {
+                evaluations[k].indices.resize(numPlacements);
+            }
+
+            for (unsigned int i = 0; i < numPlacements; ++i) {
+                size_t weightIndex = getIndex(words, i);
+                if (evaluations) {
+                    evaluations[k].indices[i] = weightIndex;
+                }
+
+                value += getHashedWeight(placementTables[i], weightIndex);
+            }
+
+            storeValue(value, k, values, evaluations);
+        }
+        break;
+    }
 }
 
 
-double NTNN::evaluate(const State& state) const
+template <unsigned int N>
+void BasicNTNN<N>::train(const BasicState<N>& state, double update)
 {
+    /* Compute the indices once, for both the evaluation and the update */
+    size_t* indices = static_cast<size_t*>(alloca(numPlacements*sizeof(size_t)));
+    getIndices(state, indices);
+
     double value = 0.0;
-    unsigned int weightIndex;
 
-    for (unsigned int i = 0; i < currentNumTuples; ++i) {
-        weightIndex = getWeightIndex(state, i);
+    switch (storage) {
 
-        if (initializeWeights && (weights[i][weightIndex] == 0)) {
-            weights[i][weightIndex] = INITIAL_WEIGHTS;
+    case DENSE:
+        switch (weightType) {
+        case DOUBLE_WEIGHTS:  value = sumDense<double>(indices); break;
+        case FLOAT_WEIGHTS:   value = sumDense<float>(indices); break;
+        case FIXED16_WEIGHTS: value = sumDense<int16_t>(indices); break;
+        case FIXED32_WEIGHTS: value = sumDense<int32_t>(indices); break;
         }
+        break;
 
-        /* If the weightIndex has never been seen before, the []
-         * operator adds it in for us, with default value 0.0.
-         */
-        value += weights[i][weightIndex];
+    case HASHED:
+        for (unsigned int i = 0; i < numPlacements; ++i) {
+            value += getHashedWeight(placementTables[i], indices[i]);
+        }
+        break;
     }
 
-    return value;
+    updateWeights(indices, alpha*(update - value));
 }
 
 
-void NTNN::train(const State& state, double update)
+template <unsigned int N>
+void BasicNTNN<N>::train(const Evaluation& evaluation, double update)
 {
-    double weightChange = alpha*(update - evaluate(state));
-    unsigned int weightIndex;
+    updateWeights(evaluation.indices.data(), alpha*(update - evaluation.value));
+}
 
-    for (unsigned int i = 0; i < currentNumTuples; ++i) {
 
-        weightIndex = getWeightIndex(state, i);
+template <unsigned int N>
+void BasicNTNN<N>::updateWeight(unsigned int tuple, size_t index, double weightChange)
+{
+    size_t entry = tuple*tableSize + index;
 
-        /* If the weightIndex has never been seen before, the []
-         * operator adds it in for us, with default value 0.0.
-         */
-        weights[i][weightIndex] += weightChange;
+    switch (weightType) {
+    case DOUBLE_WEIGHTS:  updateDenseEntry<double>(entry, weightChange); break;
+    case FLOAT_WEIGHTS:   updateDenseEntry<float>(entry, weightChange); break;
+    case FIXED16_WEIGHTS: updateDenseEntry<int16_t>(entry, weightChange); break;
+    case FIXED32_WEIGHTS: updateDenseEntry<int32_t>(entry, weightChange); break;
+    }
+}
+
+
+template <unsigned int N>
+double BasicNTNN<N>::getHashedWeight(unsigned int table, size_t index) const
+{
+    const unordered_map<size_t, double>& tableWeights = weights[table];
+    auto weight = tableWeights.find(index);
+
+    if (weight == tableWeights.end()) {
+        return initializeWeights ? INITIAL_WEIGHTS : 0.0;
     }
+    return weight->second;
 }
 
 
-unsigned int NTNN::getWeightIndex(const State& state, unsigned int tuple) const
+template <unsigned int N>
+void BasicNTNN<N>::updateWeights(const size_t* indices, double weightChange)
 {
-    unsigned int weightIndex = 0;
-    unsigned int row;
-    unsigned int col;
+    double initialWeight = initializeWeights ? INITIAL_WEIGHTS : 0.0;
 
-    for (int i = 0; i < tupleLength; ++i) {
+    switch (storage) {
+
+    case DENSE:
+        switch (weightType) {
+        case DOUBLE_WEIGHTS:  updateDense<double>(indices, weightChange); break;
+        case FLOAT_WEIGHTS:   updateDense<float>(indices, weightChange); break;
+        case FIXED16_WEIGHTS: updateDense<int16_t>(indices, weightChange); break;
+        case FIXED32_WEIGHTS: updateDense<int32_t>(indices, weightChange); break;
+        }
+        break;
+
+    case HASHED:
+        for (unsigned int i = 0; i < numPlacements; ++i) {
+            unordered_map<size_t, double>& table = weights[placementTables[i]];
+
+            /* A weight which has never been stored starts out at its 
+             * initial value, and is only added if the policy allows it.
+             */
+            if (materializePolicy == MATERIALIZE_ON_TRAIN) {
+                table.emplace(indices[i], initialWeight).first->second += weightChange;
+            } else {
+                auto weight = table.find(indices[i]);
+                if (weight != table.end()) {
+                    weight->second += weightChange;
+                }
+            }
+        }
+        break;
+    }
+}
+
+
+template <unsigned int N>
+uint64_t BasicNTNN<N>::indexToLegacyKey(size_t index) const
+{
+    uint64_t key = 0;
+    uint64_t place = 1;
+
+    /* The key holds the i-th exponent in the i-th base 100 digit */
+    for (unsigned int i = 0; i < tupleLength; ++i) {
+        key += place*((index >> (4*i)) & 0xF);
+        place *= 100;
+    }
+
+    return key;
+}
 
-        /* Convert the index given in the tuple to row/column for the grid */
-        row = tuples[tuple][i] / GRID_SIZE;
-        col = tuples[tuple][i] % GRID_SIZE;
 
-        if (state.getTile(row, col) != 0) {
-            weightIndex += pow(100, i)*log2(state.getTile(row, col));
+template <unsigned int N>
+bool BasicNTNN<N>::legacyKeyToIndex(uint64_t key, size_t& index) const
+{
+    index = 0;
+
+    for (unsigned int i = 0; i < tupleLength; ++i) {
+        unsigned int exponent = key % 100;
+        key /= 100;
+
+        if (exponent > MAX_EXPONENT) {
+            return false;
         }
+        index |= size_t(exponent) << (4*i);
     }
 
-    return weightIndex;
+    return key == 0;
 }
 
 
-void NTNN::load(const string& agentFile)
+template <unsigned int N>
+void BasicNTNN<N>::load(const string& agentFile)
 {
     fstream agent;
     agent.open(agentFile, ios::in);
 
     string line;
     unsigned int tuple = 0;
-    unsigned int weightIndex;
+    uint64_t key;
+    size_t index;
     double value;
+    double initialWeight = initializeWeights ? INITIAL_WEIGHTS : 0.0;
 
     if (agent.is_open()) {
 
@@ -168,17 +1327,32 @@ void NTNN::load(const string& agentFile)
                 stringstream keyConversion{stringKey};
                 stringstream valueConversion{stringValue};
 
-                keyConversion >> weightIndex;
+                keyConversion >> key;
                 valueConversion >> value;
 
-                weights[tuple][weightIndex] = value;
+                /* Skip any keys which no tile combination corresponds to */
+                if ((tuple >= numTuples) || !legacyKeyToIndex(key, index)) {
+                    continue;
+                }
+
+                switch (storage) {
+
+                case DENSE:
+                    setDenseEntry(tuple*tableSize + index, value - initialWeight);
+                    break;
+
+                case HASHED:
+                    weights[tuple][index] = value;
+                    break;
+                }
             }
         }
     }
 }
 
 
-void NTNN::save(const string& agentFile)
+template <unsigned int N>
+void BasicNTNN<N>::save(const string& agentFile)
 {
     fstream agent;
     agent.open(agentFile, ios::out | ios::trunc);
@@ -186,14 +1360,36 @@ void NTNN::save(const string& agentFile)
     /* Loop throough each tuple, and dump all weights associated with
      * that tuple to the file.
      */
+    double initialWeight = initializeWeights ? INITIAL_WEIGHTS : 0.0;
+
     for (unsigned int i = 0; i < currentNumTuples; ++i) {
 
-        for (auto const& element : weights[i]) {
+        switch (storage) {
+
+        case DENSE:
+            /* Weights still at their initial value need not be saved,
+             * as loading the network gives missing weights that value.
+             */
+            for (size_t j = 0; j < tableSize; ++j) {
+                double entry = getDenseEntry(i*tableSize + j);
+                if (entry != 0.0) {
+                    agent << indexToLegacyKey(j);
+                    agent << ", ";
+                    agent << entry + initialWeight;
+                    agent << "\n";
+                }
+            }
+            break;
+
+        case HASHED:
+            for (auto const& element : weights[i]) {
 
-            agent << element.first;
-            agent << ", ";
-            agent << element.second;
-            agent << "\n";
+                agent << indexToLegacyKey(element.first);
+                agent << ", ";
+                agent << element.second;
+                agent << "\n";
+            }
+            break;
         }
 
         /* We assume that this line represents the division between tuples */
@@ -202,3 +1398,401 @@ void NTNN::save(const string& agentFile)
 
     agent.close();
 }
+
+
+template <unsigned int N>
+vector<uint32_t> BasicNTNN<N>::getLayout() const
+{
+    vector<uint32_t> layout(placementTables, placementTables + numPlacements);
+    layout.insert(layout.end(), cellOffsets, cellOffsets + numPlacements*tupleLength);
+    return layout;
+}
+
+
+template <unsigned int N>
+vector<char> BasicNTNN<N>::getFilePrefix(uint64_t id) const
+{
+    vector<uint32_t> layout = getLayout();
+    size_t layoutBytes = layout.size()*sizeof(uint32_t);
+
+    AgentFileHeader header = {};
+    memcpy(header.magic, AGENT_FILE_MAGIC, sizeof(header.magic));
+    header.version = AGENT_FILE_VERSION;
+    header.gridSize = N;
+    header.numTuples = numTuples;
+    header.tupleLength = tupleLength;
+    header.numPlacements = numPlacements;
+    header.weightType = weightType;
+    header.weightScale = weightScale;
+    header.initialWeight = initializeWeights ? INITIAL_WEIGHTS : 0.0;
+    header.tableSize = tableSize;
+    header.tablesOffset = (sizeof(header) + layoutBytes + AGENT_FILE_ALIGNMENT - 1) / 
+                          AGENT_FILE_ALIGNMENT * AGENT_FILE_ALIGNMENT;
+    header.tablesBytes = denseBytes;
+    header.baseId = id;
+
+    vector<char> prefix(sizeof(header) + layoutBytes);
+    memcpy(prefix.data(), &header, sizeof(header));
+    memcpy(prefix.data() + sizeof(header), layout.data(), layoutBytes);
+    return prefix;
+}
+
+
+template <unsigned int N>
+vector<char> BasicNTNN<N>::getDeltaPrefix() const
+{
+    DeltaFileHeader header = {};
+    memcpy(header.magic, DELTA_FILE_MAGIC, sizeof(header.magic));
+    header.version = AGENT_FILE_VERSION;
+    header.sequence = nextDelta;
+    header.baseId = baseId;
+    header.tablesBytes = denseBytes;
+    header.blockSize = DELTA_BLOCK_SIZE;
+
+    vector<char> prefix(sizeof(header));
+    memcpy(prefix.data(), &header, sizeof(header));
+    return prefix;
+}
+
+
+template <unsigned int N>
+void BasicNTNN<N>::getDirtyBlocks(vector<uint64_t>& blockOffsets, vector<char>& blocks) const
+{
+    const char* tables = static_cast<const char*>(denseWeights);
+
+    blockOffsets.clear();
+    blocks.clear();
+
+    for (size_t word = 0; word < dirtyBlocks.size(); ++word) {
+        for (uint64_t bits = dirtyBlocks[word]; bits != 0; bits &= bits - 1) {
+            size_t offset = (64*word + __builtin_ctzll(bits))*DELTA_BLOCK_SIZE;
+            size_t bytes = min<size_t>(DELTA_BLOCK_SIZE, denseBytes - offset);
+            blockOffsets.push_back(offset);
+            blocks.insert(blocks.end(), tables + offset, tables + offset + bytes);
+        }
+    }
+}
+
+
+template <unsigned int N>
+void BasicNTNN<N>::startBase(uint64_t id)
+{
+    baseId = id;
+    nextDelta = 1;
+    fill(dirtyBlocks.begin(), dirtyBlocks.end(), 0);
+}
+
+
+template <unsigned int N>
+bool BasicNTNN<N>::saveBinary(const string& agentFile)
+{
+    if (storage != DENSE) {
+        return false;
+    }
+
+    uint64_t id = newBaseId();
+    if (!writeAgentFile(agentFile, getFilePrefix(id), static_cast<const char*>(denseWeights))) {
+        return false;
+    }
+
+    startBase(id);
+    return true;
+}
+
+
+template <unsigned int N>
+bool BasicNTNN<N>::saveDelta(const string& agentFile)
+{
+    if ((storage != DENSE) || (baseId == 0)) {
+        return false;
+    }
+
+    vector<uint64_t> blockOffsets;
+    vector<char> blocks;
+    getDirtyBlocks(blockOffsets, blocks);
+
+    if (!writeDeltaFile(agentFile, getDeltaPrefix(), blockOffsets, blocks)) {
+        return false;
+    }
+
+    fill(dirtyBlocks.begin(), dirtyBlocks.end(), 0);
+    ++nextDelta;
+    return true;
+}
+
+
+template <unsigned int N>
+bool BasicNTNN<N>::snapshot(WeightSnapshot& snapshot)
+{
+    if (storage != DENSE) {
+        return false;
+    }
+
+    /* The copy of the tables is mapped like the tables themselves, and
+     * only made again if the size of the tables changes.
+     */
+    if (snapshot.tablesBytes != denseBytes) {
+        if (snapshot.tables != nullptr) {
+            munmap(snapshot.tables, snapshot.tablesBytes);
+            snapshot.tables = nullptr;
+            snapshot.tablesBytes = 0;
+        }
+
+        void* block = mmap(nullptr, denseBytes, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (block == MAP_FAILED) {
+            throw bad_alloc();
+        }
+        snapshot.tables = block;
+        snapshot.tablesBytes = denseBytes;
+    }
+
+    uint64_t id = newBaseId();
+    snapshot.prefix = getFilePrefix(id);
+    snapshot.delta = false;
+
+    copyTables(static_cast<char*>(snapshot.tables), static_cast<const char*>(denseWeights), denseBytes);
+
+    /* Later deltas build on the snapshot, although it has not been saved
+     * yet, as the deltas are saved after it
+     */
+    startBase(id);
+    return true;
+}
+
+
+template <unsigned int N>
+bool BasicNTNN<N>::snapshotDelta(WeightSnapshot& snapshot)
+{
+    if ((storage != DENSE) || (baseId == 0)) {
+        return false;
+    }
+
+    snapshot.prefix = getDeltaPrefix();
+    snapshot.delta = true;
+    getDirtyBlocks(snapshot.blockOffsets, snapshot.blocks);
+
+    fill(dirtyBlocks.begin(), dirtyBlocks.end(), 0);
+    ++nextDelta;
+    return true;
+}
+
+
+template <unsigned int N>
+bool BasicNTNN<N>::copyWeights(const BasicNTNN<N>& network)
+{
+    /* The network must be built exactly like this one */
+    if ((storage != DENSE) || (network.storage != DENSE) || (network.weightType != weightType) ||
+        (network.weightScale != weightScale) || (network.initializeWeights != initializeWeights) ||
+        (network.denseBytes != denseBytes) || (network.getLayout() != getLayout())) {
+        return false;
+    }
+
+    copyTables(static_cast<char*>(denseWeights), static_cast<const char*>(network.denseWeights), denseBytes);
+
+    /* Every block may have changed since this network was last saved */
+    for (size_t offset = 0; offset < denseBytes; offset += DELTA_BLOCK_SIZE) {
+        markDirty(offset);
+    }
+    return true;
+}
+
+
+template <unsigned int N>
+bool BasicNTNN<N>::convertWeights(const BasicNTNN<N>& network)
+{
+    /* The networks must be built alike, apart from their weight types */
+    if ((storage != DENSE) || (network.storage != DENSE) || (network.numTuples != numTuples) ||
+        (network.initializeWeights != initializeWeights) || (network.tableSize != tableSize) ||
+        (network.getLayout() != getLayout())) {
+        return false;
+    }
+
+    /* setDenseEntry() marks every block it writes as changed */
+    size_t numEntries = numTuples*tableSize;
+    for (size_t i = 0; i < numEntries; ++i) {
+        setDenseEntry(i, network.getDenseEntry(i));
+    }
+    return true;
+}
+
+
+WeightSnapshot::~WeightSnapshot()
+{
+    if (tables != nullptr) {
+        munmap(tables, tablesBytes);
+    }
+}
+
+
+bool WeightSnapshot::save(const string& agentFile) const
+{
+    if (delta) {
+        return writeDeltaFile(agentFile, prefix, blockOffsets, blocks);
+    }
+
+    if (tables == nullptr) {
+        return false;
+    }
+
+    return writeAgentFile(agentFile, prefix, static_cast<const char*>(tables));
+}
+
+
+template <unsigned int N>
+bool BasicNTNN<N>::loadBinary(const string& agentFile)
+{
+    if (storage != DENSE) {
+        return false;
+    }
+
+    int fd = open(agentFile.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    AgentFileHeader header;
+    struct stat info;
+    bool valid = (pread(fd, &header, sizeof(header), 0) == sizeof(header)) && (fstat(fd, &info) == 0);
+
+    /* The file must hold tables for a network built exactly like this one */
+    valid = valid && (memcmp(header.magic, AGENT_FILE_MAGIC, sizeof(header.magic)) == 0) &&
+            (header.version == AGENT_FILE_VERSION) && (header.gridSize == N) &&
+            (header.numTuples == numTuples) && (header.tupleLength == tupleLength) &&
+            (header.numPlacements == numPlacements) && (header.weightType == uint32_t(weightType)) &&
+            (header.weightScale == weightScale) && 
+            (header.initialWeight == (initializeWeights ? INITIAL_WEIGHTS : 0.0)) &&
+            (header.tableSize == tableSize) && (header.tablesBytes == denseBytes) &&
+            (header.tablesOffset % sysconf(_SC_PAGESIZE) == 0) &&
+            (uint64_t(info.st_size) >= header.tablesOffset + header.tablesBytes);
+
+    vector<uint32_t> layout = getLayout();
+    vector<uint32_t> fileLayout(layout.size());
+    size_t layoutBytes = layout.size()*sizeof(uint32_t);
+    valid = valid && (pread(fd, fileLayout.data(), layoutBytes, sizeof(header)) == ssize_t(layoutBytes)) &&
+            (fileLayout == layout);
+
+    /* Map the tables straight from the file. The mapping is private, so
+     * training changes this network's copy of a page, not the file.
+     */
+    void* block = MAP_FAILED;
+    if (valid) {
+        block = mmap(nullptr, denseBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, header.tablesOffset);
+    }
+
+    if (block == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    /* Check the blocks of the tables which hold data. The holes of the
+     * file read as zeros, so they are skipped.
+     */
+    const char* tables = static_cast<const char*>(block);
+    uint64_t checksum = checksumBytes(layout.data(), layoutBytes, 0xcbf29ce484222325ull);
+    size_t offset = 0;
+
+    while (offset < denseBytes) {
+        off_t data = lseek(fd, header.tablesOffset + offset, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) {
+                break;
+            }
+            /* The file system cannot find holes, so check every block */
+            data = header.tablesOffset + offset;
+        }
+
+        offset = (data - header.tablesOffset) / AGENT_FILE_ALIGNMENT * AGENT_FILE_ALIGNMENT;
+        if (offset >= denseBytes) {
+            break;
+        }
+
+        size_t bytes = min<size_t>(AGENT_FILE_ALIGNMENT, denseBytes - offset);
+        checksum = checksumBlock(tables, offset, bytes, checksum);
+        offset += AGENT_FILE_ALIGNMENT;
+    }
+    close(fd);
+
+    if (checksum != header.checksum) {
+        munmap(block, denseBytes);
+        return false;
+    }
+
+    munmap(denseWeights, denseBytes);
+    denseWeights = block;
+
+    startBase(header.baseId);
+    applyDeltas(agentFile);
+    return true;
+}
+
+
+template <unsigned int N>
+void BasicNTNN<N>::applyDeltas(const string& agentFile)
+{
+    char* tables = static_cast<char*>(denseWeights);
+    vector<char> data;
+
+    /* Apply the deltas in order, up to the first one which is missing or
+     * does not follow on from the ones before
+     */
+    while (readFile(deltaFileName(agentFile, nextDelta), data)) {
+
+        DeltaFileHeader header;
+        if (data.size() < sizeof(header)) {
+            break;
+        }
+        memcpy(&header, data.data(), sizeof(header));
+
+        if ((memcmp(header.magic, DELTA_FILE_MAGIC, sizeof(header.magic)) != 0) ||
+            (header.version != AGENT_FILE_VERSION) || (header.sequence != nextDelta) ||
+            (header.baseId != baseId) || (header.tablesBytes != denseBytes) ||
+            (header.blockSize != DELTA_BLOCK_SIZE)) {
+            break;
+        }
+
+        /* Check the whole file before changing any weights */
+        uint64_t checksum = 0xcbf29ce484222325ull;
+        size_t position = sizeof(header);
+        bool valid = true;
+
+        for (uint64_t i = 0; valid && (i < header.numBlocks); ++i) {
+            uint64_t offset;
+            valid = (data.size() - position >= sizeof(offset));
+            if (valid) {
+                memcpy(&offset, data.data() + position, sizeof(offset));
+                valid = (offset % DELTA_BLOCK_SIZE == 0) && (offset < denseBytes);
+            }
+            if (valid) {
+                size_t bytes = min<size_t>(DELTA_BLOCK_SIZE, denseBytes - offset);
+                valid = (data.size() - position - sizeof(offset) >= bytes);
+                if (valid) {
+                    checksum = checksumBytes(data.data() + position, sizeof(offset) + bytes, checksum);
+                    position += sizeof(offset) + bytes;
+                }
+            }
+        }
+
+        if (!valid || (position != data.size()) || (checksum != header.checksum)) {
+            break;
+        }
+
+        position = sizeof(header);
+        for (uint64_t i = 0; i < header.numBlocks; ++i) {
+            uint64_t offset;
+            memcpy(&offset, data.data() + position, sizeof(offset));
+            size_t bytes = min<size_t>(DELTA_BLOCK_SIZE, denseBytes - offset);
+            memcpy(tables + offset, data.data() + position + sizeof(offset), bytes);
+            position += sizeof(offset) + bytes;
+        }
+
+        ++nextDelta;
+    }
+}
+
+
+/* Compile every supported board size */
+template class BasicNTNN<3>;
+template class BasicNTNN<4>;
+template class BasicNTNN<5>;
+template class BasicNTNN<6>;
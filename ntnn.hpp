@@ -8,12 +8,164 @@
 #define NTNN_H 1
 
 #include <unordered_map>
+#include <vector>
 #include <string>
+#include <cstddef>
+#include <cstdint>
 #include "state.hpp"
 
 /* These weights are used if nonzero intialization is used */
 #define INITIAL_WEIGHTS 10.0
 
+/* Longest tuples which get dense weight tables unless asked otherwise */
+#define MAX_DENSE_TUPLE_LENGTH 6
+
+/* Longest tuples whose dense tables hold doubles unless asked otherwise.
+ * Longer tuples get floats, so a 6-tuple's table takes 64 MB, not 128 MB.
+ */
+#define MAX_DOUBLE_TUPLE_LENGTH 5
+
+
+/**
+ * This enum defines the ways the network can store its weights.
+ *
+ * HASHED: One hash map per tuple, which only holds the weights that have
+ *         been used so far. This suits long tuples, as most of their 
+ *         tile combinations never show up.
+ * DENSE: One flat table per tuple, with a weight for every combination
+ *        of tile exponents, indexed directly by the tuple's tiles. This
+ *        is much faster, but each table holds 16^length weights.
+ */
+enum WeightStorage {HASHED, DENSE};
+
+/* Default scale factors of fixed-point weights. A 16-bit weight covers
+ * -512 to 512 in steps of 1/64, and a 32-bit weight covers -32768 to
+ * 32768 in steps of 1/65536.
+ */
+#define FIXED16_SCALE 64.0
+#define FIXED32_SCALE 65536.0
+
+/**
+ * This enum defines the types of the weights in dense tables. The value
+ * of a state is summed up in double precision for floating-point weights,
+ * and exactly, as a 64-bit integer, for fixed-point weights.
+ *
+ * DOUBLE_WEIGHTS: 8 bytes per weight, as precise as HASHED storage
+ * FLOAT_WEIGHTS: 4 bytes per weight, which halves the size of the tables
+ *                and is precise enough for training
+ * FIXED16_WEIGHTS: 2 bytes per weight, stored as the weight times a scale
+ *                  factor, rounded to an integer (and clamped to the 
+ *                  integer's range). Meant for agents which only play,
+ *                  as small training updates are lost to the rounding.
+ * FIXED32_WEIGHTS: 4 bytes per weight, stored like FIXED16_WEIGHTS
+ */
+enum WeightType {DOUBLE_WEIGHTS, FLOAT_WEIGHTS, FIXED16_WEIGHTS, FIXED32_WEIGHTS};
+
+/**
+ * This enum defines when a network with HASHED storage stores a weight 
+ * for a tile combination it has not seen before. Either way, evaluate()
+ * never stores anything: it reads a missing weight as its initial value.
+ *
+ * MATERIALIZE_ON_TRAIN: train() stores every weight it updates
+ * NEVER_MATERIALIZE: train() only updates the weights which are already
+ *                    stored (loaded, or stored earlier), so the maps 
+ *                    never grow. Meant for fine-tuning a loaded agent
+ *                    without its memory growing.
+ */
+enum MaterializePolicy {MATERIALIZE_ON_TRAIN, NEVER_MATERIALIZE};
+
+
+/**
+ * This structure describes a network's tuple placements in the layout
+ * used by the AVX2 evaluate kernel (see ntnn.cpp), which handles eight
+ * placements per vector register. The entry for cell i of placement p 
+ * is at index i*stride + p of shifts and halves, where stride is the 
+ * number of placements rounded up to a multiple of eight.
+ *
+ * shifts: Shift which brings the cell's exponent down to the lowest 
+ *         bits of its 32-bit half of the packed board
+ * halves: All ones if the cell is in the high half of the board, or 0
+ * bases: Offset of each placement's table within the dense tables
+ */
+struct GatherLayout
+{
+    unsigned int stride = 0;
+    uint32_t* shifts = nullptr;
+    uint32_t* halves = nullptr;
+    int32_t* bases = nullptr;
+};
+
+
+/**
+ * This structure holds a network's evaluation of a state: the weight index
+ * of each placement (see NTNN::getIndices()) and the value of the state.
+ * Pass it to NTNN::train() to train the network on the state without 
+ * computing its indices and looking up its weights again. Reuse the same
+ * objects from one evaluation to the next, so that their indices are only
+ * allocated once.
+ */
+struct Evaluation
+{
+    std::vector<size_t> indices;
+    double value = 0.0;
+};
+
+
+/**
+ * This class holds a copy of a network's dense tables, taken with 
+ * NTNN::snapshot(), which can be saved to a binary agent file (see 
+ * NTNN::saveBinary()) while the network carries on training. A snapshot
+ * keeps its memory from one copy to the next. A snapshot taken with
+ * NTNN::snapshotDelta() only holds the blocks of the tables which changed
+ * since the last snapshot, and is saved as a delta file instead (see
+ * NTNN::saveDelta()).
+ */
+class WeightSnapshot
+{
+    template <unsigned int N> friend class BasicNTNN;
+
+private:
+
+    /* Header and placement layout of the agent file (see ntnn.cpp) */
+    std::vector<char> prefix;
+
+    /* Copy of the dense tables, mapped like the network's own tables */
+    void* tables = nullptr;
+
+    /* Size of the copy of the tables, in bytes */
+    size_t tablesBytes = 0;
+
+    /* Whether the snapshot is a delta, held in the two vectors below */
+    bool delta = false;
+
+    /* Offsets of the changed blocks within the tables, and the blocks */
+    std::vector<uint64_t> blockOffsets;
+    std::vector<char> blocks;
+
+public:
+
+    WeightSnapshot() = default;
+    WeightSnapshot(const WeightSnapshot&) = delete;
+    WeightSnapshot& operator=(const WeightSnapshot&) = delete;
+
+    /**
+     * This is simply the object destructor.
+     */
+    ~WeightSnapshot();
+
+    /**
+     * This function saves the copied tables to a binary agent file, 
+     * exactly as NTNN::saveBinary() would have saved the network when
+     * the snapshot was taken, or, for a delta, saves the next delta file
+     * of the agent file as NTNN::saveDelta() would have.
+     *
+     * :param agentFile: path to the file to which we want to save the weights
+     *
+     * :return: Whether the weights were saved
+     */
+    bool save(const std::string& agentFile) const;
+};
+
 
 /**
  * This class implements an n-tuple regression network which
@@ -34,8 +186,13 @@
  * The tuples of the n-tuple network are literally tuples of these
  * indices, say, for example (0, 1, 2, 3). This would be a 4-tuple
  * across the top row of the game board. 
+ *
+ * The network is built for the N x N board of BasicState<N>, where the 
+ * same scheme numbers cell (row, col) as row*N + col. The programs use 
+ * the GRID_SIZE x GRID_SIZE network through the NTNN type defined below.
  */
-class NTNN
+template <unsigned int N>
+class BasicNTNN
 {
 
 private:
@@ -43,6 +200,33 @@ private:
     /* Structure to hold the tuples. Will be a 2d array */
     unsigned int** tuples;
 
+    /* Number of placements of the tuples on the board. A tuple added with
+     * addTuple() has one placement, and a tuple added with 
+     * addSymmetricTuple() has one for each of its symmetric positions.
+     */
+    unsigned int numPlacements = 0;
+
+    /* The tuple (weight table) which each placement reads */
+    unsigned int* placementTables;
+
+    /* Bit offset of each placement's cells within the state's packed 
+     * board words (see BasicState::getBoardWords()). The tupleLength 
+     * offsets of placement p start at entry p*tupleLength.
+     */
+    unsigned int* cellOffsets;
+
+    /* Whether evaluate() uses the AVX2 gather kernel. By default, this is
+     * the case for dense tables of doubles, floats or 32-bit fixed-point
+     * weights on boards of up to 4x4, when the CPU supports AVX2 (see
+     * setEvaluateKernel()).
+     */
+    bool gatherEvaluate = false;
+
+    /* The placements, laid out for the AVX2 gather kernel, whose arrays
+     * are only allocated when the network can use the kernel
+     */
+    GatherLayout gather;
+
     /* The number of tuples in the network */
     unsigned int numTuples;
 
@@ -58,8 +242,47 @@ private:
     /* Whether the weights are initially zero, or the value INITIAL_WEIGHTS */
     bool initializeWeights;
 
-    /* An array of weight maps (one map per tuple) */
-    std::unordered_map<unsigned int, double>* weights;
+    /* How the weights are stored */
+    WeightStorage storage;
+
+    /* An array of weight maps (one map per tuple), used by HASHED storage */
+    std::unordered_map<size_t, double>* weights = nullptr;
+
+    /* When train() stores weights missing from the maps */
+    MaterializePolicy materializePolicy = MATERIALIZE_ON_TRAIN;
+
+    /* Type of the weights in the dense tables */
+    WeightType weightType;
+
+    /* Scale factor of fixed-point weights (stored entry = entry * scale) */
+    double weightScale;
+
+    /* Number of weights in each dense table (16^tupleLength) */
+    size_t tableSize = 0;
+
+    /* Size of the block holding the dense tables, in bytes */
+    size_t denseBytes = 0;
+
+    /* The dense tables, used by DENSE storage. Table t starts at entry
+     * t*tableSize of this single, page aligned block of weightType 
+     * entries. Each entry holds the weight minus its initial value, so 
+     * that a zeroed block is a freshly initialized network. The block is
+     * mapped without reserving memory: the system hands out zeroed pages
+     * as the network first writes to them, so only the parts of the 
+     * tables which are actually trained take up memory.
+     */
+    void* denseWeights = nullptr;
+
+    /* One bit for each block of the dense tables which changed since
+     * the network was last saved (see saveDelta())
+     */
+    std::vector<uint64_t> dirtyBlocks;
+
+    /* Id of the binary agent file which the next delta builds on (0 if 
+     * there is none), and the number of the next delta
+     */
+    uint64_t baseId = 0;
+    uint32_t nextDelta = 1;
 
 public:
 
@@ -75,7 +298,7 @@ public:
      *
      * :return: New n-tuple neural network
      */
-    NTNN(unsigned int num, unsigned int length, double alpha);
+    BasicNTNN(unsigned int num, unsigned int length, double alpha);
 
     /**
      * This is the standard constructor for the n-tuple network. With this
@@ -89,12 +312,65 @@ public:
      *
      * :return: New n-tuple neural network
      */
-    NTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights);
+    BasicNTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights);
+
+    /**
+     * This constructor also lets you choose how the weights are stored.
+     * The other constructors use DENSE storage for tuples of up to 
+     * MAX_DENSE_TUPLE_LENGTH tiles, and HASHED storage for longer ones.
+     * Dense tables hold doubles for tuples of up to MAX_DOUBLE_TUPLE_LENGTH
+     * tiles, and floats for longer ones.
+     *
+     * :param num: Number of tuples to be in the network
+     * :param length: Length of each individual tuple
+     * :param alpha: Learning rate of the network
+     * :param initializeWeights: Whether the network's weights are initially nonzero
+     * :param storage: How the network stores its weights
+     *
+     * :return: New n-tuple neural network
+     */
+    BasicNTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights, WeightStorage storage);
+
+    /**
+     * This constructor also lets you choose the type of the weights in
+     * dense tables. The memory the tables may take up, which for 6-tuples
+     * is 64 MB per tuple with FLOAT_WEIGHTS, is given by getMemoryBudget(),
+     * for the programs to report. Fixed-point weights use the scale factor
+     * FIXED16_SCALE or FIXED32_SCALE.
+     *
+     * :param num: Number of tuples to be in the network
+     * :param length: Length of each individual tuple
+     * :param alpha: Learning rate of the network
+     * :param initializeWeights: Whether the network's weights are initially nonzero
+     * :param storage: How the network stores its weights
+     * :param weightType: Type of the weights in dense tables
+     *
+     * :return: New n-tuple neural network
+     */
+    BasicNTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights, 
+              WeightStorage storage, WeightType weightType);
+
+    /**
+     * This constructor also lets you choose the scale factor of fixed-point
+     * weights. A weight w is stored as the integer closest to w*scale.
+     *
+     * :param num: Number of tuples to be in the network
+     * :param length: Length of each individual tuple
+     * :param alpha: Learning rate of the network
+     * :param initializeWeights: Whether the network's weights are initially nonzero
+     * :param storage: How the network stores its weights
+     * :param weightType: Type of the weights in dense tables
+     * :param weightScale: Scale factor of fixed-point weights
+     *
+     * :return: New n-tuple neural network
+     */
+    BasicNTNN(unsigned int num, unsigned int length, double alpha, bool initializeWeights, 
+              WeightStorage storage, WeightType weightType, double weightScale);
 
     /**
      * This is simply the object destructor.
      */
-    ~NTNN();
+    ~BasicNTNN();
 
     /**
      * This member function allows a user to add a tuple to the network.
@@ -109,27 +385,186 @@ public:
      */
     bool addTuple(unsigned int* tuple, unsigned int length);
 
+    /**
+     * This member function adds a tuple to the network along with its 
+     * images under all of the board's rotations and reflections. All of
+     * these placements share one weight table, so a pattern learned in
+     * one corner of the board is known in every corner. The function
+     * fails in the same cases as addTuple().
+     *
+     * :param tuple: Array containing the tuple to be added
+     * :param length: Length of the tuple array
+     *
+     * :return: Whether the tuple was added successfully or not 
+     */
+    bool addSymmetricTuple(unsigned int* tuple, unsigned int length);
+
+    /**
+     * Gets the number of tuples which have been added to the network,
+     * which is also the number of weight tables.
+     *
+     * :return: Number of tuples in the network
+     */
+    unsigned int getNumTuples() const;
+
+    /**
+     * Gets the most memory the network's dense tables can take up, which
+     * is reserved when the network is built. This is zero for HASHED
+     * storage, whose memory grows with the number of weights used.
+     *
+     * :return: Size of the dense tables, in bytes
+     */
+    size_t getMemoryBudget() const;
+
+    /**
+     * Gets the number of placements of the tuples on the board, which is
+     * the number of weights that make up the value of a state.
+     *
+     * :return: Number of tuple placements in the network
+     */
+    unsigned int getNumPlacements() const;
+
+    /**
+     * Gets the tuple (weight table) which the given placement reads.
+     *
+     * :param placement: Index of the placement
+     *
+     * :return: Index of the placement's tuple
+     */
+    unsigned int getPlacementTuple(unsigned int placement) const;
+
+    /**
+     * Gets the learning rate of the network.
+     *
+     * :return: Learning rate of the network
+     */
+    double getAlpha() const;
+
+    /**
+     * Sets when train() stores weights which are missing from the weight
+     * maps of HASHED storage (see MaterializePolicy). The default is 
+     * MATERIALIZE_ON_TRAIN. Dense tables always hold every weight.
+     *
+     * :param policy: When train() stores missing weights
+     *
+     * :return: (None)
+     */
+    void setMaterializePolicy(MaterializePolicy policy);
+
+    /**
+     * This function computes the weight index of every tuple placement 
+     * for the given state. This is the index kernel shared by evaluate() and 
+     * train(): the exponent of the tuple's i-th tile is stored in bits
+     * 4i to 4i+3 of the index, and it is built from the packed board with
+     * integer shifts only. Both storage types use the same indices.
+     *
+     * :param state: State for which to compute the weight indices
+     * :param indices: Array of getNumPlacements() weight indices (return value)
+     *
+     * :return: (None)
+     */
+    void getIndices(const BasicState<N>& state, size_t* indices) const;
+
     /**
      * This function evaluates a given state and returns its value
-     * based on the weights of the network. 
+     * based on the weights of the network. Evaluating never changes the
+     * network, so several threads may evaluate states with one network
+     * at the same time, as long as no thread trains it meanwhile.
      *
      * :param state: State to be evaluated
      *
      * :return: Value of the given state
      */
-    double evaluate(const State& state) const;
+    double evaluate(const BasicState<N>& state) const;
+
+    /**
+     * This function evaluates several states at once, which is faster
+     * than evaluating them one by one: the weight indices of a batch of 
+     * states are all computed before any weights are loaded, so that the
+     * loads can overlap. Each value is the same as evaluate() gives.
+     *
+     * :param states: Array of states to be evaluated
+     * :param count: Number of states in the states array
+     * :param values: Array of count values of the given states (return value)
+     *
+     * :return: (None)
+     */
+    void evaluate(const BasicState<N>* states, unsigned int count, double* values) const;
+
+    /**
+     * This function evaluates several states like the batched evaluate()
+     * above, but also keeps the weight indices of each state, so that the
+     * network can later be trained on any of them with train().
+     *
+     * :param states: Array of states to be evaluated
+     * :param count: Number of states in the states array
+     * :param evaluations: Array of count evaluations of the given states (return value)
+     *
+     * :return: (None)
+     */
+    void evaluate(const BasicState<N>* states, unsigned int count, Evaluation* evaluations) const;
+
+    /**
+     * Chooses the kernel which evaluate() uses, rather than the fastest
+     * one the network supports, so that the kernels can be checked
+     * against each other (see checkNtnnEvaluate.cpp). Choose the kernel
+     * before any thread evaluates states with the network.
+     *
+     * :param kernel: Name of the kernel: "avx2" (the gather kernel) or "scalar"
+     *
+     * :return: Whether the network supports the kernel (if not, the
+     *          kernel in use is kept)
+     */
+    bool setEvaluateKernel(const char* kernel);
 
     /**
      * This member function allows the user to present the network with 
      * a training example. The user provides a state with a corresponding
      * value, and the network updates its weights accordingly.
      *
+     * Several threads may train and evaluate a network with DENSE storage
+     * at once, without any locking (see parallelLearning.cpp). Updates are
+     * sparse, so they rarely touch the same weight at the same moment, and
+     * when they do, one of them is simply lost. Networks with HASHED 
+     * storage must only be used by one thread while they are trained.
+     *
      * :param state: State on which to train the network
      * :param update: Value update to be given to the given state
      *
      * :return: (None)
      */
-    void train(const State& state, double update);
+    void train(const BasicState<N>& state, double update);
+
+    /**
+     * This function trains the network on a state which it evaluated 
+     * earlier, using the indices and value kept in the evaluation, so no
+     * indices are computed and no weights are looked up. The result is 
+     * the same as training on the state itself (up to rounding), provided
+     * the network has not been trained since the evaluation. Otherwise, 
+     * the update is based on the old value.
+     *
+     * :param evaluation: Evaluation of the state on which to train the network
+     * :param update: Value update to be given to the evaluated state
+     *
+     * :return: (None)
+     */
+    void train(const Evaluation& evaluation, double update);
+
+    /**
+     * This function adds the given change to a single weight: the weight
+     * at the given index of the given tuple's table. Training on a state
+     * adds alpha*(update - value) to the weight at each placement's index,
+     * so this lets a training backend split that work among threads by 
+     * tuple (see shardedtrainer.hpp). Like train(), it may be called from
+     * several threads at once. The network must use DENSE storage.
+     *
+     * :param tuple: Tuple whose table holds the weight
+     * :param index: Index of the weight within the table (see getIndices())
+     * :param weightChange: Change to add to the weight
+     *
+     * :return: (None)
+     */
+    void updateWeight(unsigned int tuple, size_t index, double weightChange);
 
     /**
      * This function allows you to load the weights contained within the 
@@ -152,20 +587,302 @@ public:
      */
     void save(const std::string& agentFile);
 
+    /**
+     * This function saves the dense tables of the network to a binary
+     * agent file, which loadBinary() can use without parsing it. The file
+     * holds a versioned header (the tuple layout, the weight type, the 
+     * size of the tables and a checksum), followed by the tables as they
+     * are laid out in memory. The file is written under a temporary name
+     * and then renamed, so it is never left half written. Networks with
+     * HASHED storage cannot be saved this way. The delta files of the
+     * old agent file are removed, as the new file takes their place.
+     *
+     * :param agentFile: path to the file to which we want to save the weights
+     *
+     * :return: Whether the weights were saved
+     */
+    bool saveBinary(const std::string& agentFile);
+
+    /**
+     * This function saves only the blocks of the dense tables which changed
+     * since the network was last saved, loaded or snapshotted, as the next
+     * delta file of the given agent file (<agentFile>.delta1, .delta2 and
+     * so on). This is much quicker than saveBinary() when training only
+     * touches a small part of the tables between saves. The agent file
+     * itself must have been saved (or loaded) first. Save a full agent 
+     * file now and then to fold the deltas back into it.
+     *
+     * :param agentFile: path to the agent file the delta builds on
+     *
+     * :return: Whether the delta was saved
+     */
+    bool saveDelta(const std::string& agentFile);
+
+    /**
+     * This function loads the weights of the network from a binary agent
+     * file written by saveBinary(). The file is mapped into memory and
+     * used as the network's dense tables directly, so loading takes no 
+     * time beyond checking the checksum. The network must be built like
+     * the one which saved the file, including its tuples, so add the 
+     * tuples before loading. Otherwise, or if the file is damaged, the
+     * network is left unchanged. The deltas saved since the file are then
+     * applied in order, up to the first one which is missing or damaged.
+     *
+     * :param agentFile: path to the file from which we want to load the weights
+     *
+     * :return: Whether the weights were loaded
+     */
+    bool loadBinary(const std::string& agentFile);
+
+    /**
+     * This function copies the dense tables of the network into the given
+     * snapshot, which can then be saved on another thread while this 
+     * network carries on training. Only the blocks of the tables which
+     * hold data are copied. Networks with HASHED storage have no snapshots.
+     * Later deltas build on the snapshot, so save it before them.
+     *
+     * :param snapshot: Snapshot to hold the copy of the tables (return value)
+     *
+     * :return: Whether the snapshot was taken
+     */
+    bool snapshot(WeightSnapshot& snapshot);
+
+    /**
+     * This function copies the blocks of the dense tables which changed
+     * since the last snapshot (or save, or load) into the given snapshot,
+     * which then saves the next delta file (see saveDelta()). Deltas must
+     * be saved in the order in which they were taken.
+     *
+     * :param snapshot: Snapshot to hold the changed blocks (return value)
+     *
+     * :return: Whether the snapshot was taken
+     */
+    bool snapshotDelta(WeightSnapshot& snapshot);
+
+    /**
+     * This function copies the weights of another network into this one,
+     * which is quicker than saving and loading them. Both networks must
+     * use DENSE storage and be built exactly alike, including their
+     * tuples. The other network may be trained while it is copied, in
+     * which case the copy holds each weight from before or after each
+     * update, like a state evaluated meanwhile would (see train()).
+     *
+     * :param network: Network whose weights to copy
+     *
+     * :return: Whether the weights were copied
+     */
+    bool copyWeights(const BasicNTNN<N>& network);
+
+    /**
+     * This function copies the weights of another network into this one,
+     * like copyWeights(), but the networks may use different weight
+     * types. Each weight is converted to this network's type, so copying
+     * into fixed-point weights rounds (and clamps) them. This turns a
+     * trained agent into a smaller one which only plays (see convertAgent).
+     * The other network must not be trained while it is converted.
+     *
+     * :param network: Network whose weights to convert
+     *
+     * :return: Whether the weights were converted
+     */
+    bool convertWeights(const BasicNTNN<N>& network);
+
 
 private:
 
     /**
-     * This function is a helper function that calculates the index 
-     * to the weight map for a given state and tuple. 
+     * This function is a helper function that calculates the weight index
+     * of a single placement (see getIndices()) from the packed board words.
      *
-     * :param state: State for which to compute the weight index
-     * :param tuple: Index of the tuple for which we wish to calculate the weight index
+     * :param words: Packed board words of the state
+     * :param placement: Index of the placement for which we wish to calculate the weight index
      *
      * :return: Weight index
      */
-    unsigned int getWeightIndex(const State& state, unsigned int tuple) const;
+    size_t getIndex(const uint64_t* words, unsigned int placement) const;
+
+    /**
+     * This function looks up a weight of HASHED storage without changing
+     * the maps: a weight which has not been stored has its initial value.
+     *
+     * :param table: Tuple (weight map) which holds the weight
+     * :param index: Weight index within the tuple's map
+     *
+     * :return: Value of the weight
+     */
+    double getHashedWeight(unsigned int table, size_t index) const;
+
+    /**
+     * This function gathers the placement layout of the network, as it is
+     * stored in binary agent files: the table of each placement, followed
+     * by the cell offsets of each placement.
+     *
+     * :return: Layout of the network's placements
+     */
+    std::vector<uint32_t> getLayout() const;
+
+    /**
+     * This function builds the start of a binary agent file for the 
+     * network: its header, without the checksum, and its placement layout.
+     *
+     * :param id: Base id of the agent file
+     *
+     * :return: Header and placement layout of the network's agent file
+     */
+    std::vector<char> getFilePrefix(uint64_t id) const;
+
+    /**
+     * This function builds the header of the network's next delta file,
+     * without the number of blocks and the checksum.
+     *
+     * :return: Header of the next delta file
+     */
+    std::vector<char> getDeltaPrefix() const;
+
+    /**
+     * This function copies out the blocks of the dense tables which changed
+     * since the network was last saved.
+     *
+     * :param blockOffsets: Offsets of the changed blocks (return value)
+     * :param blocks: Contents of the changed blocks, one after the other (return value)
+     *
+     * :return: (None)
+     */
+    void getDirtyBlocks(std::vector<uint64_t>& blockOffsets, std::vector<char>& blocks) const;
+
+    /**
+     * This function marks the block of the dense tables holding the given
+     * byte as changed.
+     *
+     * :param offset: Offset of the byte within the dense tables
+     *
+     * :return: (None)
+     */
+    void markDirty(size_t offset);
+
+    /**
+     * This function records that the tables were just saved (or loaded)
+     * as the agent file with the given base id: no block has changed
+     * since, and the next delta is the first.
+     *
+     * :param id: Base id of the agent file
+     *
+     * :return: (None)
+     */
+    void startBase(uint64_t id);
+
+    /**
+     * This function applies the deltas of the given agent file which follow
+     * on from the loaded tables (see loadBinary()).
+     *
+     * :param agentFile: path to the agent file the deltas build on
+     *
+     * :return: (None)
+     */
+    void applyDeltas(const std::string& agentFile);
+
+    /**
+     * This function implements both batched evaluate() functions. The
+     * values of the states are stored in values, unless it is nullptr, in
+     * which case the values and indices go to evaluations instead.
+     *
+     * :param states: Array of states to be evaluated
+     * :param count: Number of states in the states array
+     * :param values: Array of count values of the given states, or nullptr (return value)
+     * :param evaluations: Array of count evaluations of the given states, or nullptr (return value)
+     *
+     * :return: (None)
+     */
+    void evaluateStates(const BasicState<N>* states, unsigned int count, double* values, 
+                        Evaluation* evaluations) const;
+
+    /**
+     * This function adds the given change to the weights at the given 
+     * indices, one per placement (see getIndices()).
+     *
+     * :param indices: Array of getNumPlacements() weight indices
+     * :param weightChange: Change to add to each weight
+     *
+     * :return: (None)
+     */
+    void updateWeights(const size_t* indices, double weightChange);
+
+    /**
+     * These functions evaluate states, add up the weights at the given
+     * indices, and change those weights, when the weights are stored in
+     * dense tables of the given type (double, float, int16_t or int32_t,
+     * see WeightTraits in ntnn.cpp).
+     */
+    template <typename Weight>
+    void evaluateDense(const BasicState<N>* states, unsigned int count, double* values, 
+                       Evaluation* evaluations) const;
+
+    template <typename Weight>
+    double sumDense(const size_t* indices) const;
+
+    template <typename Weight>
+    void updateDense(const size_t* indices, double weightChange);
+
+    template <typename Weight>
+    void updateDenseEntry(size_t entry, double weightChange);
+
+    /**
+     * This function evaluates states with the AVX2 gather kernel, which
+     * computes the weight indices of eight placements at a time in vector
+     * registers, and gathers and sums their weights. The results match 
+     * the scalar code up to rounding, as the weights are added up in a
+     * different order.
+     *
+     * :param states: Array of states to be evaluated
+     * :param count: Number of states in the states array
+     * :param values: Array of count values of the given states, or nullptr (return value)
+     * :param evaluations: Array of count evaluations of the given states, or nullptr (return value)
+     *
+     * :return: (None)
+     */
+    void evaluateGather(const BasicState<N>* states, unsigned int count, double* values, 
+                        Evaluation* evaluations) const;
+
+    /**
+     * These functions read and write entry i of the dense tables (the
+     * weight minus its initial value), whatever the type of the weights.
+     */
+    double getDenseEntry(size_t i) const;
+    void setDenseEntry(size_t i, double value);
+
+    /**
+     * This function adds a placement of a tuple on the given cells, which
+     * reads the given weight table.
+     *
+     * :param cells: Array of tupleLength cells covered by the placement
+     * :param table: Index of the tuple whose weight table the placement reads
+     *
+     * :return: (None)
+     */
+    void addPlacement(const unsigned int* cells, unsigned int table);
+
+    /**
+     * Gets the bit offset of a cell within the packed board words.
+     *
+     * :param cell: Index of the cell
+     *
+     * :return: Bit offset of the cell's exponent
+     */
+    static unsigned int getCellOffset(unsigned int cell);
+
+    /**
+     * These functions convert between a weight index and the key saved to
+     * disk. For compatibility with agents saved by earlier versions, the
+     * key holds the exponent of the tuple's i-th tile in its i-th base 100
+     * digit. Keys which no combination of tiles corresponds to are rejected.
+     */
+    uint64_t indexToLegacyKey(size_t index) const;
+    bool legacyKeyToIndex(uint64_t key, size_t& index) const;
 
 };
 
+
+/* The network the programs use as their value function */
+typedef BasicNTNN<GRID_SIZE> NTNN;
+
 #endif
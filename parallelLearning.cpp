@@ -0,0 +1,401 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <cmath>
+#include <stdlib.h>
+#include <time.h>
+
+#include "state.hpp"
+#include "game.hpp"
+#include "ntnn.hpp"
+#include "shardedtrainer.hpp"
+
+using namespace std;
+
+#define NUM_TUPLES 17
+#define TUPLE_LENGTH 4
+
+/* How the threads train the shared value function:
+ * HOGWILD: Every thread writes straight to the weights (see NTNN::train())
+ * SHARDED: The tables are split among shard threads, which alone write to
+ *          them (see shardedtrainer.hpp)
+ */
+enum TrainingBackend {HOGWILD, SHARDED};
+
+/* These values are the parameters that define an experiment.
+ * GAMES: The number of games per run, shared among the run's threads
+ * ALPHA: The NTNN's learning rate
+ * MAX_THREADS: The largest number of threads to train with (0 for one per
+ *              core). The experiment trains a new agent with 1, 2, 4, ...
+ *              threads, up to this number.
+ * WEIGHT_TYPE: Type of the value function's weights
+ * TRAINING_BACKEND: How the threads train the value function (see above)
+ * SHARD_THREADS: Number of threads which own the tables with the SHARDED
+ *                backend, on top of the threads which play the games
+ * CURVE_POINTS: Number of points of the learning curves printed to compare
+ *               the runs (each the mean score over a stretch of games)
+ */
+#define GAMES 100000
+#define ALPHA 0.005
+#define MAX_THREADS 0
+#define WEIGHT_TYPE FLOAT_WEIGHTS
+#define TRAINING_BACKEND HOGWILD
+#define SHARD_THREADS 2
+#define CURVE_POINTS 10
+
+
+
+/* Declare a struct which is used to collect experiment results. The
+ * threads each write the entries of the games they play, so the wins are
+ * not stored as a vector<bool>, whose entries share bytes.
+ */
+struct Results
+{
+    vector<unsigned int> scores;
+    vector<unsigned char> wins;
+};
+
+
+/**
+ * This function computes the best action to take given the expansion of
+ * the current game state, and the current value function. The function
+ * chooses the action which maximizes the sum of the value of the next
+ * afterstate and the obtained reward.
+ *
+ * The afterstates of the possible actions are evaluated into evaluations,
+ * with the evaluation of the best action's afterstate moved to the front,
+ * so that the network can later be trained on it without evaluating it
+ * again.
+ *
+ * :param expansion: Expansion of the current game state
+ * :param V: Current value function
+ * :param evaluations: Array of NUM_ACTIONS evaluations, the first of which
+ *                     holds the best action's afterstate (return value)
+ *
+ * :return: The best action to take in the current state
+ */
+Action getBestAction(const Expansion& expansion, const NTNN& V, Evaluation* evaluations)
+{
+    Action bestAction = UP;
+    double bestValue = -numeric_limits<double>::infinity();
+    double value;
+
+    Action actions[NUM_ACTIONS];
+    State afterStates[NUM_ACTIONS];
+    unsigned int numActions = 0;
+    unsigned int best = 0;
+
+    /* Evaluate the afterstates of all of the possible actions at once */
+    for (unsigned int a = 0; a < NUM_ACTIONS; ++a) {
+        if (expansion.legalMoves & (1u << a)) {
+            actions[numActions] = static_cast<Action>(a);
+            afterStates[numActions] = expansion.afterStates[a];
+            ++numActions;
+        }
+    }
+    V.evaluate(afterStates, numActions, evaluations);
+
+    for (unsigned int i = 0; i < numActions; ++i) {
+
+        /* Compute the value of the action, and check if
+         * the action compares favorably to previous results.
+         */
+        value = double(expansion.logRewards[actions[i]]) + evaluations[i].value;
+        if (value > bestValue) {
+            bestValue = value;
+            bestAction = actions[i];
+            best = i;
+        }
+    }
+
+    swap(evaluations[0], evaluations[best]);
+
+    return bestAction;
+}
+
+
+/**
+ * This function is run by each of the training threads. The thread takes
+ * the next game which has not been played yet, plays it while training
+ * the shared value function with temporal difference learning on the
+ * game's afterstates (exactly as afterStateLearning does), and records
+ * the game's score and outcome, until all of the games are played. The
+ * threads train the value function without locking it (see NTNN::train()),
+ * or through the sharded trainer, if there is one.
+ *
+ * :param V: Value function shared by the threads
+ * :param trainer: Sharded trainer of the value function, or nullptr
+ * :param worker: Number of the thread, from 0 up
+ * :param seed: Seed from which the seeds of the games are derived
+ * :param nextGame: Index of the next game to be played, shared by the threads
+ * :param results: Results of the games, indexed by game (return value)
+ *
+ * :return: (None)
+ */
+void trainGames(NTNN& V, ShardedTrainer* trainer, unsigned int worker, uint64_t seed, atomic<unsigned int>& nextGame, Results& results)
+{
+    /* Evaluations of the afterstates, kept from game to game so that
+     * their indices are only allocated once
+     */
+    Evaluation evaluations[NUM_ACTIONS];
+    Evaluation afterState;
+
+    for (unsigned int gameIndex = nextGame++; gameIndex < GAMES; gameIndex = nextGame++)
+    {
+        Game game{Rng::streamSeed(seed, gameIndex)};
+        Expansion expansion = game.expand();
+
+        Action bestAction;
+        Action nextBestAction;
+        double valueUpdate;
+
+        while (expansion.legalMoves != 0)
+        {
+            bestAction = getBestAction(expansion, V, evaluations);
+            swap(afterState, evaluations[0]);
+
+            /* Execute the chosen move, and expand the next state */
+            game.takeAction(bestAction, expansion);
+            expansion = game.expand();
+
+            /* Start the learning part of the algorithm */
+            if (expansion.legalMoves != 0) {
+                nextBestAction = getBestAction(expansion, V, evaluations);
+
+                valueUpdate = double(expansion.logRewards[nextBestAction]);
+                valueUpdate += evaluations[0].value;
+
+            } else {
+                valueUpdate = -50.0;
+            }
+
+            if (trainer != nullptr) {
+                trainer->train(worker, afterState, valueUpdate);
+            } else {
+                V.train(afterState, valueUpdate);
+            }
+        }
+
+        /* Record the results of the current game */
+        results.scores[gameIndex] = game.getScore();
+        results.wins[gameIndex] = (game.getMaxTile() >= 2048);
+    }
+}
+
+
+/**
+ * This function trains a new agent on GAMES games of 2048, with the given
+ * number of threads sharing one value function, trained with the 
+ * TRAINING_BACKEND.
+ * The games are the same for every number of threads, as each game's seed
+ * only depends on its index.
+ *
+ * :param seed: Seed from which the seeds of the games are derived
+ * :param numThreads: Number of threads which play games and train the agent
+ * :param results: Results of the games, indexed by game (return value)
+ *
+ * :return: Time taken to play and learn from the games, in seconds
+ */
+double parallelLearning(uint64_t seed, unsigned int numThreads, Results& results)
+{
+    /* Declare the value function. Only dense tables can be trained by
+     * several threads at once.
+     */
+    NTNN V(NUM_TUPLES, TUPLE_LENGTH, ALPHA, false, DENSE, WEIGHT_TYPE);
+
+    /* Add the tuples to the n-tuple regression network */
+    unsigned int tuples[NUM_TUPLES][TUPLE_LENGTH] = {
+                                                      {0, 1, 2, 3}, {4, 5, 6, 7},
+                                                      {8, 9, 10, 11}, {12, 13, 14, 15},
+                                                      {0, 4, 8, 12}, {1, 5, 9, 13},
+                                                      {2, 6, 10, 14}, {3, 7, 11, 15},
+                                                      {0, 1, 4, 5}, {1, 2, 5, 6},
+                                                      {2, 3, 6, 7}, {4, 5, 8, 9},
+                                                      {5, 6, 9, 10}, {6, 7, 10, 11},
+                                                      {8, 9, 12, 13}, {9, 10, 13, 14},
+                                                      {10, 11, 14, 15}
+                                                    };
+    for (int i = 0; i < NUM_TUPLES; ++i) {
+        V.addTuple(tuples[i], TUPLE_LENGTH);
+    }
+
+    results.scores.assign(GAMES, 0);
+    results.wins.assign(GAMES, 0);
+    atomic<unsigned int> nextGame(0);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    unique_ptr<ShardedTrainer> trainer;
+    if (TRAINING_BACKEND == SHARDED) {
+        trainer.reset(new ShardedTrainer(V, numThreads, SHARD_THREADS));
+    }
+
+    vector<thread> threads;
+    for (unsigned int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(trainGames, ref(V), trainer.get(), i, seed, ref(nextGame), ref(results));
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    /* The run is only over once the shards have applied every update */
+    if (trainer) {
+        trainer->finish();
+    }
+
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+/**
+ * This function computes the learning curve of a run: the mean score over
+ * each of CURVE_POINTS equal stretches of the games, in game order.
+ *
+ * :param results: Results of the run
+ *
+ * :return: Mean score of each stretch of games
+ */
+vector<double> learningCurve(const Results& results)
+{
+    vector<double> curve(CURVE_POINTS, 0.0);
+
+    for (unsigned int point = 0; point < CURVE_POINTS; ++point) {
+        unsigned int first = uint64_t(GAMES)*point / CURVE_POINTS;
+        unsigned int last = uint64_t(GAMES)*(point + 1) / CURVE_POINTS;
+
+        for (unsigned int i = first; i < last; ++i) {
+            curve[point] += results.scores[i];
+        }
+        if (last > first) {
+            curve[point] /= double(last - first);
+        }
+    }
+
+    return curve;
+}
+
+
+/**
+ * This is the function which runs the program. In this program, we train
+ * agents to play the game 2048 using Temporal Difference learning applied
+ * to the game's afterstates, with several threads training each agent at
+ * once. The program reports how the number of games played per second
+ * scales with the number of threads, and compares the learning curve of
+ * each run to that of the single threaded run.
+ *
+ * :param argc: Number of command line arguments
+ * :param argv: Command line arguments
+ *
+ * :return: Error code (0 = no error)
+ */
+int main(int argc, char **argv)
+{
+    /* Every game's seed is derived from this master seed, so printing
+     * it lets us reproduce the experiment later on.
+     */
+    uint64_t masterSeed = time(NULL);
+
+    unsigned int maxThreads = MAX_THREADS;
+    if (maxThreads == 0) {
+        maxThreads = max(thread::hardware_concurrency(), 1u);
+    }
+
+    /* Run with 1, 2, 4, ... threads, and finally with all of them */
+    vector<unsigned int> threadCounts;
+    for (unsigned int numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    const char* backendName = (TRAINING_BACKEND == SHARDED) ? "SHARD" : "PAR";
+
+    cout << "Training Backend: " << ((TRAINING_BACKEND == SHARDED) ? "Sharded" : "Hogwild") << endl;
+    cout << "Learning Rate: " << ALPHA << endl;
+    cout << "Number of Games per Run: " << GAMES << endl;
+    cout << "Seed: " << masterSeed << endl;
+
+    double singleRate = 0.0;
+    vector<double> singleCurve;
+
+    for (unsigned int numThreads : threadCounts)
+    {
+        Results runResults;
+        double seconds = parallelLearning(masterSeed, numThreads, runResults);
+        double rate = GAMES / seconds;
+        vector<double> curve = learningCurve(runResults);
+
+        if (numThreads == 1) {
+            singleRate = rate;
+            singleCurve = curve;
+        }
+
+        /* Compare the run to the single threaded one */
+        double largestDifference = 0.0;
+        for (unsigned int point = 0; point < CURVE_POINTS; ++point) {
+            double difference = (curve[point] - singleCurve[point]) / singleCurve[point];
+            if (abs(difference) > abs(largestDifference)) {
+                largestDifference = difference;
+            }
+        }
+
+        cout << "Threads: " << numThreads;
+        cout << "; Games/s: " << rate;
+        cout << "; Speedup: " << rate / singleRate;
+        cout << "; Largest difference to single thread curve: ";
+        cout << 100.0*largestDifference << "%" << endl;
+
+        cout << "    Learning curve (mean score):";
+        for (double score : curve) {
+            cout << " " << int(score);
+        }
+        cout << endl;
+
+        /* Create the names of the results files */
+        ostringstream scoresFileName;
+        scoresFileName << "results/";
+        scoresFileName << "TD_" << backendName << "_" << numThreads << "_" << GAMES << "_" << int(1000*ALPHA) << "_scores.csv";
+
+        ostringstream winsFileName;
+        winsFileName << "results/";
+        winsFileName << "TD_" << backendName << "_" << numThreads << "_" << GAMES << "_" << int(1000*ALPHA) << "_wins.csv";
+
+        /* Save the data to a csv file in the results folder */
+        fstream scoresFile;
+        fstream winsFile;
+        scoresFile.open(scoresFileName.str(), ios::out | ios::app);
+        winsFile.open(winsFileName.str(), ios::out | ios::app);
+
+        for (unsigned int i = 0; i < GAMES; ++i) {
+
+            scoresFile << runResults.scores[i];
+            winsFile << int(runResults.wins[i]);
+
+            if (i != GAMES-1) {
+                scoresFile << ", ";
+                winsFile << ", ";
+            }
+        }
+
+        scoresFile << '\n';
+        winsFile << '\n';
+
+        scoresFile.close();
+        winsFile.close();
+    }
+
+    return 0;
+}
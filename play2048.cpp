@@ -27,9 +27,6 @@ using namespace std;
 int main(int argc, char **argv)
 {
 
-    /* Initialize the random seed */
-    srand(time(NULL));
-
     /* Print the rules of the game */
     cout << "Game rules:" << endl;
     cout << "Up = 5" << endl;
@@ -37,7 +34,7 @@ int main(int argc, char **argv)
     cout << "Left = 1" << endl;
     cout << "Right = 3\n" << endl;
 
-    /* Start the game */
+    /* Start the game. Its tiles are seeded from the system's entropy source */
     Game game = Game();
     Action actions[NUM_ACTIONS];
 
@@ -10,7 +10,6 @@
 #include <string>
 #include <limits>
 #include <vector>
-#include <cmath>
 #include <stdlib.h>
 #include <time.h>
 
@@ -48,8 +47,7 @@ struct Results
  * value function.
  *
  * :param state: Reference to the current state
- * :param actions: Array of available actions in the current state
- * :param numActions: Number of actions in the actions array
+ * :param legalMoves: Mask of the available actions in the current state
  * :param V_up: Value function for the up state-action pairs
  * :param V_down: Value function for the down state-action pairs
  * :param V_left: Value function for the left state-action pairs
@@ -57,16 +55,20 @@ struct Results
  *
  * :return: The best action to take in the current state
  */
-Action getBestAction(const State& state, Action* actions, int numActions, const NTNN& V_up, const NTNN& V_down, const NTNN& V_left, const NTNN& V_right)
+Action getBestAction(const State& state, unsigned int legalMoves, const NTNN& V_up, const NTNN& V_down, const NTNN& V_left, const NTNN& V_right)
 {
-    Action bestAction;
+    Action bestAction = UP;
     Action a;
     double bestValue = -numeric_limits<double>::infinity();
     double value;
 
-    for (int i = 0; i < numActions; ++i) {
-        
-        a = actions[i];
+    for (unsigned int i = 0; i < NUM_ACTIONS; ++i) {
+
+        if (!(legalMoves & (1u << i))) {
+            continue;
+        }
+
+        a = static_cast<Action>(i);
 
         /* Compute the value of the action, and check if 
          * the action compares favorably to previous results.
@@ -96,10 +98,12 @@ Action getBestAction(const State& state, Action* actions, int numActions, const
  * pairs. The scores and outcomes of the games which the agent plays are 
  * returned. Each set of games played by the agent is called an experiment.
  *
+ * :param seed: Seed from which the seeds of the games are derived
+ *
  * :return: The results of the experiment (wins and scores as a function of
  *          number of games played)
  */
-Results qLearning()
+Results qLearning(uint64_t seed)
 {
     /* Create the struct to store the experiment results */
     Results results;
@@ -129,17 +133,13 @@ Results qLearning()
         V_right.addTuple(tuples[i], TUPLE_LENGTH);
     }
 
-    Action actions[4];
-    unsigned int numActions;
-    
     /* Run the training loop */
     for (unsigned int gameIndex = 0; gameIndex < GAMES; ++gameIndex)
     {
-        Game game;
-        numActions = game.getActions(actions);
+        Game game{Rng::streamSeed(seed, gameIndex)};
+        Expansion expansion = game.expand();
 
         State state;
-        State afterState;
         State nextState;
 
         Action bestAction;
@@ -147,22 +147,23 @@ Results qLearning()
         unsigned int reward;
         double vNext;
 
-        while (numActions > 0)
+        while (expansion.legalMoves != 0)
         {
             state = game.getState();
 
             /* Use the agent's policy to choose the next move to take */
-            bestAction = getBestAction(state, actions, numActions, V_up, V_down, V_left, V_right);
-            reward = game.takeAction(bestAction, afterState);
+            bestAction = getBestAction(state, expansion.legalMoves, V_up, V_down, V_left, V_right);
+            reward = expansion.logRewards[bestAction];
+            game.takeAction(bestAction, expansion);
 
             /* Get the new state of the game */
             nextState = game.getState();
-            numActions = game.getActions(actions);
+            expansion = game.expand();
 
             /* Start the learning part of the algorithm */
-            if (numActions > 0) {
+            if (expansion.legalMoves != 0) {
 
-                nextBestAction = getBestAction(nextState, actions, numActions, V_up, V_down, V_left, V_right);
+                nextBestAction = getBestAction(nextState, expansion.legalMoves, V_up, V_down, V_left, V_right);
 
                 /* Get the value of the next state, using the action selected above */
                 if (nextBestAction == UP) {
@@ -178,11 +179,6 @@ Results qLearning()
                 //vNext *= 0.8;
 
                 /* Use Q-Learning to update the value of the state-action pair */
-
-                if (reward != 0) {
-                    reward = log2(reward);
-                }
-
                 if (bestAction == UP) {
                     V_up.train(state, double(reward) + vNext);
                 } else if (bestAction == DOWN) {
@@ -238,11 +234,14 @@ Results qLearning()
  */
 int main(int argc, char **argv)
 {
-    /* Initialize the random seed */
-    srand(time(NULL));
+    /* Every game's seed is derived from this master seed, so printing
+     * it lets us reproduce the experiment later on.
+     */
+    uint64_t masterSeed = time(NULL);
 
     cout << "Learning Rate: " << ALPHA << endl;
     cout << "Number of Games per Experiment: " << GAMES << endl;
+    cout << "Seed: " << masterSeed << endl;
 
     for (int experiment = 1; experiment <= NUM_EXPERIMENTS; ++experiment)
     {
@@ -250,7 +249,7 @@ int main(int argc, char **argv)
         cout << "Experiment " << experiment << " / " << NUM_EXPERIMENTS << endl;
 
         /* Collect the results from each of the experiments */
-        Results experimentResults = qLearning();
+        Results experimentResults = qLearning(Rng::streamSeed(masterSeed, experiment));
 
 
         /* Create the names of the results files */
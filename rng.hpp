@@ -0,0 +1,130 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#ifndef RNG_H
+#define RNG_H 1
+
+#include <cstdint>
+
+
+/**
+ * This class is a small, fast random number generator (xoshiro256**)
+ * used to spawn tiles. Each Game owns one, so games never share random
+ * state, and every game is reproducible from its seed.
+ *
+ * To run an experiment reproducibly, pick one master seed and seed game
+ * number i with streamSeed(masterSeed, i). Game i then plays out the same
+ * way no matter which thread runs it, or in which order.
+ */
+class Rng
+{
+
+private:
+
+    /* The generator's 256 bits of state */
+    uint64_t s[4];
+
+public:
+
+    /**
+     * The constructor for a Rng object. The seed is expanded into the
+     * full generator state with splitmix64, so any seed (even zero) is
+     * fine to use.
+     *
+     * :param seed: Seed for the generator
+     *
+     * :return: New Rng object
+     */
+    explicit Rng(uint64_t seed)
+    {
+        for (int i = 0; i < 4; ++i) {
+            s[i] = splitMix(seed);
+        }
+    }
+
+    /**
+     * Returns the next 64 random bits from the generator.
+     *
+     * :return: Uniformly distributed 64-bit integer
+     */
+    uint64_t next()
+    {
+        uint64_t result = rotate(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotate(s[3], 45);
+
+        return result;
+    }
+
+    /**
+     * Returns a random double drawn uniformly from [0, 1).
+     *
+     * :return: Uniformly distributed double
+     */
+    double nextDouble()
+    {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * Returns a random integer drawn uniformly from [0, n). This uses a
+     * multiply and shift rather than a division.
+     *
+     * :param n: Upper bound (exclusive) of the integer
+     *
+     * :return: Uniformly distributed integer less than n
+     */
+    unsigned int nextBelow(unsigned int n)
+    {
+        return (unsigned int) (((next() >> 32) * uint64_t(n)) >> 32);
+    }
+
+    /**
+     * Derives the seed of one stream (say, one game) from a master seed.
+     * Different streams of the same master seed are independent.
+     *
+     * :param masterSeed: Seed for the whole experiment
+     * :param stream: Index of the stream within the experiment
+     *
+     * :return: Seed for the given stream
+     */
+    static uint64_t streamSeed(uint64_t masterSeed, uint64_t stream)
+    {
+        uint64_t x = masterSeed;
+        uint64_t seed = splitMix(x) ^ stream;
+        return splitMix(seed);
+    }
+
+private:
+
+    /**
+     * Rotates a 64-bit integer left by k bits.
+     */
+    static uint64_t rotate(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    /**
+     * Advances a splitmix64 generator stored in x and returns its output.
+     */
+    static uint64_t splitMix(uint64_t& x)
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+};
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include "shardedtrainer.hpp"
+
+using namespace std;
+
+/* Number of updates each queue from a worker to a shard can hold */
+#define SHARD_QUEUE_SIZE 4096
+
+
+template <unsigned int N>
+BasicShardedTrainer<N>::BasicShardedTrainer(BasicNTNN<N>& network, unsigned int numWorkers,
+                                            unsigned int numShards)
+    : network(network),
+      numWorkers(numWorkers),
+      numShards(numShards),
+      stopping(false)
+{
+    /* Count the placements of each tuple, which is how many of the
+     * tuple's weights a training step updates
+     */
+    unsigned int numPlacements = network.getNumPlacements();
+    vector<unsigned int> tuplePlacements(network.getNumTuples(), 0);
+
+    for (unsigned int i = 0; i < numPlacements; ++i) {
+        ++tuplePlacements[network.getPlacementTuple(i)];
+    }
+
+    /* Hand each tuple to the shard with the fewest placements so far */
+    vector<unsigned int> tupleShards(tuplePlacements.size());
+    vector<unsigned int> shardPlacements(numShards, 0);
+
+    for (unsigned int tuple = 0; tuple < tuplePlacements.size(); ++tuple) {
+        unsigned int shard = 0;
+        for (unsigned int s = 1; s < numShards; ++s) {
+            if (shardPlacements[s] < shardPlacements[shard]) {
+                shard = s;
+            }
+        }
+        tupleShards[tuple] = shard;
+        shardPlacements[shard] += tuplePlacements[tuple];
+    }
+
+    placementShards.resize(numPlacements);
+    for (unsigned int i = 0; i < numPlacements; ++i) {
+        placementShards[i] = tupleShards[network.getPlacementTuple(i)];
+    }
+
+    for (unsigned int i = 0; i < numWorkers*numShards; ++i) {
+        queues.emplace_back(new SpscQueue<WeightUpdate>(SHARD_QUEUE_SIZE));
+    }
+
+    for (unsigned int shard = 0; shard < numShards; ++shard) {
+        shards.emplace_back(&BasicShardedTrainer<N>::runShard, this, shard);
+    }
+}
+
+
+template <unsigned int N>
+BasicShardedTrainer<N>::~BasicShardedTrainer()
+{
+    finish();
+}
+
+
+template <unsigned int N>
+void BasicShardedTrainer<N>::train(unsigned int worker, const Evaluation& evaluation, double update)
+{
+    double weightChange = network.getAlpha()*(update - evaluation.value);
+    unique_ptr<SpscQueue<WeightUpdate>>* workerQueues = &queues[worker*numShards];
+
+    for (unsigned int i = 0; i < placementShards.size(); ++i) {
+        WeightUpdate weightUpdate = {evaluation.indices[i], network.getPlacementTuple(i), weightChange};
+        SpscQueue<WeightUpdate>& queue = *workerQueues[placementShards[i]];
+
+        while (!queue.push(weightUpdate)) {
+            this_thread::yield();
+        }
+    }
+}
+
+
+template <unsigned int N>
+void BasicShardedTrainer<N>::finish()
+{
+    stopping.store(true, memory_order_release);
+
+    for (thread& shard : shards) {
+        shard.join();
+    }
+    shards.clear();
+}
+
+
+template <unsigned int N>
+void BasicShardedTrainer<N>::runShard(unsigned int shard)
+{
+    WeightUpdate weightUpdate;
+
+    while (true) {
+
+        /* Once stopping is seen, every update has been pushed, so the
+         * shard is done as soon as it finds all of its queues empty
+         */
+        bool finishing = stopping.load(memory_order_acquire);
+        bool idle = true;
+
+        for (unsigned int worker = 0; worker < numWorkers; ++worker) {
+            SpscQueue<WeightUpdate>& queue = *queues[worker*numShards + shard];
+
+            /* Take at most a queue's worth of updates from each worker in
+             * turn, so that a busy worker cannot hold up the others
+             */
+            for (unsigned int i = 0; (i < SHARD_QUEUE_SIZE) && queue.pop(weightUpdate); ++i) {
+                network.updateWeight(weightUpdate.tuple, weightUpdate.index, weightUpdate.weightChange);
+                idle = false;
+            }
+        }
+
+        if (idle) {
+            if (finishing) {
+                break;
+            }
+            this_thread::yield();
+        }
+    }
+}
+
+
+/* Compile every supported board size */
+template class BasicShardedTrainer<3>;
+template class BasicShardedTrainer<4>;
+template class BasicShardedTrainer<5>;
+template class BasicShardedTrainer<6>;
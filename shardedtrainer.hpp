@@ -0,0 +1,145 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#ifndef SHARDEDTRAINER_H
+#define SHARDEDTRAINER_H 1
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "ntnn.hpp"
+#include "spscqueue.hpp"
+
+
+/**
+ * This structure is the update of a single weight, which a worker thread
+ * hands to the shard owning the weight's table.
+ */
+struct WeightUpdate
+{
+    /* Index of the weight within its tuple's table */
+    size_t index;
+
+    /* Tuple whose table holds the weight */
+    unsigned int tuple;
+
+    /* Change to add to the weight, kept as a double so that no precision
+     * is lost for networks with DOUBLE_WEIGHTS
+     */
+    double weightChange;
+};
+
+
+/**
+ * Class which trains a network with DENSE storage from several threads
+ * by splitting its tables among shard threads, instead of letting every
+ * thread write to every table (see NTNN::train()). Each shard thread owns
+ * a set of tuples, and is the only thread which writes their tables, so
+ * the tables see no contention and stay in the cache of the shard's core.
+ *
+ * Worker threads play games and evaluate states with the network as
+ * usual, but train it through train() below. This computes the change of
+ * each placement's weight once, and hands it to the shard owning the
+ * placement's tuple through a lock-free queue, one per worker and shard
+ * (see spscqueue.hpp). The shards apply the changes as they come in, so
+ * a worker may evaluate a state before its own last updates are applied.
+ */
+template <unsigned int N>
+class BasicShardedTrainer
+{
+
+private:
+
+    /* The network being trained */
+    BasicNTNN<N>& network;
+
+    /* Number of worker threads, which call train() */
+    unsigned int numWorkers;
+
+    /* Number of shard threads, which own the tables */
+    unsigned int numShards;
+
+    /* Shard which owns the tuple of each placement */
+    std::vector<unsigned int> placementShards;
+
+    /* Queue from worker w to shard s, at entry w*numShards + s */
+    std::vector<std::unique_ptr<SpscQueue<WeightUpdate>>> queues;
+
+    /* Whether the shard threads should apply what is left and exit */
+    std::atomic<bool> stopping;
+
+    /* The shard threads */
+    std::vector<std::thread> shards;
+
+public:
+
+    /**
+     * The constructor for a ShardedTrainer object, which shares out the
+     * network's tuples among the shards and starts the shard threads. The
+     * tuples are shared out so that each shard updates about as many
+     * weights per training step, so add them to the network first.
+     *
+     * :param network: Network to train, which must use DENSE storage
+     * :param numWorkers: Number of worker threads which call train()
+     * :param numShards: Number of shard threads to split the tables among
+     *
+     * :return: New ShardedTrainer object
+     */
+    BasicShardedTrainer(BasicNTNN<N>& network, unsigned int numWorkers, unsigned int numShards);
+
+    /**
+     * The destructor applies any updates still waiting in the queues, then
+     * stops the shard threads (see finish()).
+     */
+    ~BasicShardedTrainer();
+
+    BasicShardedTrainer(const BasicShardedTrainer&) = delete;
+    BasicShardedTrainer& operator=(const BasicShardedTrainer&) = delete;
+
+    /**
+     * Trains the network on a state which it evaluated earlier, like
+     * NTNN::train(), by handing the weight changes to the shards. Each
+     * worker thread must always pass its own worker number. If a shard's
+     * queue is full, this waits for the shard to catch up.
+     *
+     * :param worker: Number of the calling worker thread, from 0 to numWorkers - 1
+     * :param evaluation: Evaluation of the state on which to train the network
+     * :param update: Value update to be given to the evaluated state
+     *
+     * :return: (None)
+     */
+    void train(unsigned int worker, const Evaluation& evaluation, double update);
+
+    /**
+     * Waits for the shards to apply every update handed to them so far,
+     * and stops the shard threads. Call this once the workers are done;
+     * train() must not be called afterwards.
+     *
+     * :return: (None)
+     */
+    void finish();
+
+private:
+
+    /**
+     * This function is run by each shard thread. It applies the updates
+     * from every worker's queue to the shard's tables, until finish().
+     *
+     * :param shard: Number of the shard
+     *
+     * :return: (None)
+     */
+    void runShard(unsigned int shard);
+
+};
+
+
+/* The trainer of the network the programs use */
+typedef BasicShardedTrainer<GRID_SIZE> ShardedTrainer;
+
+#endif
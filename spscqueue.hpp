@@ -0,0 +1,132 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H 1
+
+#include <cstddef>
+#include <atomic>
+#include <vector>
+
+/* Size of a cache line, which the two ends of a queue are kept apart by */
+#define CACHE_LINE_SIZE 64
+
+
+/**
+ * This class is a bounded, lock-free queue for passing items from exactly
+ * one producer thread to exactly one consumer thread. The items live in a
+ * ring of slots. The producer only writes the tail of the ring and the
+ * consumer only writes the head, so neither ever waits on a lock. The
+ * two ends sit on separate cache lines, and each thread keeps a copy of
+ * the other end's position, so that the threads only touch each other's
+ * cache line when the ring looks full (or empty).
+ */
+template <typename T>
+class SpscQueue
+{
+
+private:
+
+    /* The ring of slots, whose size is a power of two */
+    std::vector<T> slots;
+
+    /* Size of the ring minus one, to wrap positions around it */
+    size_t mask;
+
+    char padding0[CACHE_LINE_SIZE];
+
+    /* Position of the next slot to push to, written by the producer */
+    std::atomic<size_t> tail;
+
+    /* The producer's copy of head, which is at most as far on as head */
+    size_t cachedHead = 0;
+
+    char padding1[CACHE_LINE_SIZE];
+
+    /* Position of the next slot to pop from, written by the consumer */
+    std::atomic<size_t> head;
+
+    /* The consumer's copy of tail, which is at most as far on as tail */
+    size_t cachedTail = 0;
+
+    char padding2[CACHE_LINE_SIZE];
+
+public:
+
+    /**
+     * The constructor for a SpscQueue object.
+     *
+     * :param capacity: Number of items the queue can hold, which is
+     *                  rounded up to a power of two
+     *
+     * :return: New, empty SpscQueue object
+     */
+    explicit SpscQueue(size_t capacity)
+        : tail(0), head(0)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * Adds an item to the back of the queue. Only the producer thread may
+     * call this function.
+     *
+     * :param item: Item to add
+     *
+     * :return: Whether the item was added (false if the queue is full)
+     */
+    bool push(const T& item)
+    {
+        size_t position = tail.load(std::memory_order_relaxed);
+
+        if (position - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead > mask) {
+                return false;
+            }
+        }
+
+        slots[position & mask] = item;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Takes the item at the front of the queue. Only the consumer thread
+     * may call this function.
+     *
+     * :param item: Item taken from the queue (return value)
+     *
+     * :return: Whether an item was taken (false if the queue is empty)
+     */
+    bool pop(T& item)
+    {
+        size_t position = head.load(std::memory_order_relaxed);
+
+        if (position == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail) {
+                return false;
+            }
+        }
+
+        item = slots[position & mask];
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+};
+
+#endif
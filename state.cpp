@@ -1,4 +1,4 @@
-/** 
+/**
  * Written by Andrew Donelick
  * EELE 577 - Advanced Digial Signal Processing
  * Final Project
@@ -6,360 +6,567 @@
 
 #include <iostream>
 #include <iomanip>
-#include <random>
-#include <stdlib.h>
 #include "state.hpp"
+#include "moves.hpp"
 
 
 using namespace std;
 
 
-State::State()
+/**
+ * These functions read and write the exponent of a cell of a packed
+ * board, where the cells are numbered in reading order. Sixteen cells
+ * fit in each word, starting from its most significant nibble.
+ */
+static inline unsigned int getCell(const uint64_t* board, unsigned int cell)
 {
-    /* Initialize the grid to zero */
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-            grid[row][col] = 0;
-        }
-    }
+    return (board[cell / 16] >> (4*(15 - cell % 16))) & 0xF;
+}
 
-    /* Start by inserting two tiles into the grid */
-    insertNewTile();
-    insertNewTile();
+static inline void setCell(uint64_t* board, unsigned int cell, unsigned int exponent)
+{
+    unsigned int shift = 4*(15 - cell % 16);
+    board[cell / 16] = (board[cell / 16] & ~(uint64_t(0xF) << shift)) | (uint64_t(exponent & 0xF) << shift);
 }
 
 
-State::State(const State& otherState)
+/**
+ * This structure holds the board operations that depend on the size of
+ * the board. The generic version works on any N x N board with loops over
+ * the cells; since N is known at compile time, the compiler can unroll
+ * them completely. BoardOps<4> below replaces them with the table-driven
+ * move engine and the bit tricks of moves.hpp.
+ */
+template <unsigned int N>
+struct BoardOps
 {
-    /* Copy over the data from one grid to the other */
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-            grid[row][col] = otherState.grid[row][col];
+    static const unsigned int WORDS = BasicState<N>::BOARD_WORDS;
+
+    /**
+     * Slides the tiles of every line of the board towards the start of
+     * the line, and returns the reward for the merges. Line k starts at
+     * cell first + k*lineStep, and its cells are cellStep apart.
+     *
+     * This code is quite similar to the action code used by
+     * Szubert and Jaskowski in their 2048 project.
+     * You can find the original code here:
+     * https://github.com/mszubert/2048
+     */
+    static unsigned int slide(uint64_t* board, int first, int lineStep, int cellStep)
+    {
+        unsigned int reward = 0;
+
+        for (unsigned int line = 0; line < N; ++line) {
+
+            int start = first + int(line)*lineStep;
+            int firstFree = 0;
+            bool alreadyAggregated = false;
+
+            for (int i = 0; i < int(N); ++i) {
+
+                unsigned int exponent = getCell(board, start + i*cellStep);
+                if (exponent == 0) {
+                    continue;
+                }
+
+                if ((firstFree > 0) && (!alreadyAggregated) && (exponent < MAX_EXPONENT) &&
+                    (getCell(board, start + (firstFree-1)*cellStep) == exponent)) {
+                    setCell(board, start + (firstFree-1)*cellStep, exponent + 1);
+                    setCell(board, start + i*cellStep, 0);
+                    reward += 1u << (exponent + 1);
+                    alreadyAggregated = true;
+                } else {
+                    setCell(board, start + i*cellStep, 0);
+                    setCell(board, start + (firstFree++)*cellStep, exponent);
+                    alreadyAggregated = false;
+                }
+            }
         }
+
+        return reward;
+    }
+
+    static unsigned int slideUp(uint64_t* board)
+    {
+        return slide(board, 0, 1, N);
     }
-}
 
+    static unsigned int slideDown(uint64_t* board)
+    {
+        return slide(board, (N-1)*N, 1, -int(N));
+    }
 
-State& State::operator=(const State& otherState)
-{
-    /* Copy over the data from one grid to the other */
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-            grid[row][col] = otherState.grid[row][col];
+    static unsigned int slideLeft(uint64_t* board)
+    {
+        return slide(board, 0, N, 1);
+    }
+
+    static unsigned int slideRight(uint64_t* board)
+    {
+        return slide(board, N-1, N, -1);
+    }
+
+    /**
+     * Checks whether sliding the lines (laid out as for slide()) would
+     * change the board. That happens when some tile has an empty cell,
+     * or an equal tile it can merge with, just before it in its line.
+     */
+    static bool canSlide(const uint64_t* board, int first, int lineStep, int cellStep)
+    {
+        for (unsigned int line = 0; line < N; ++line) {
+
+            int start = first + int(line)*lineStep;
+
+            for (int i = 1; i < int(N); ++i) {
+
+                unsigned int previous = getCell(board, start + (i-1)*cellStep);
+                unsigned int exponent = getCell(board, start + i*cellStep);
+
+                if ((exponent != 0) && ((previous == 0) || ((previous == exponent) && (exponent < MAX_EXPONENT)))) {
+                    return true;
+                }
+            }
         }
+
+        return false;
     }
-}
 
+    static unsigned int legalMoves(const uint64_t* board)
+    {
+        return unsigned(canSlide(board, 0, 1, N)) |
+               (unsigned(canSlide(board, (N-1)*N, 1, -int(N))) << 1) |
+               (unsigned(canSlide(board, 0, N, 1)) << 2) |
+               (unsigned(canSlide(board, N-1, N, -1)) << 3);
+    }
 
-void State::insertNewTile()
-{
-    random_device rd;
-    mt19937 e2(rd());
-    uniform_real_distribution<> dist(0, 1);
+    /**
+     * Writes the board transformed by one of the symmetries to result,
+     * by moving every cell to its new position.
+     */
+    static void transform(const uint64_t* board, uint64_t* result, Symmetry symmetry)
+    {
+        for (unsigned int i = 0; i < WORDS; ++i) {
+            result[i] = 0;
+        }
 
-    /* Get the possible indices where we can insert a tile */
-    unsigned int rowIndices[GRID_SIZE*GRID_SIZE];
-    unsigned int colIndices[GRID_SIZE*GRID_SIZE];
-    unsigned int numZeros = getEmptyTiles(rowIndices, colIndices);
+        for (unsigned int row = 0; row < N; ++row) {
+            for (unsigned int col = 0; col < N; ++col) {
 
-    /* Choose whether to insert a 2 or a 4 */
-    unsigned int insertValue;
-    if (dist(e2) < TWO_PROBABILITY) {
-        insertValue = 2;
-    } else {
-        insertValue = 4;
+                /* Rotate clockwise as many times as needed, then mirror */
+                unsigned int newRow = row;
+                unsigned int newCol = col;
+                for (unsigned int k = 0; k < (symmetry & 3u); ++k) {
+                    unsigned int temp = newRow;
+                    newRow = newCol;
+                    newCol = N - 1 - temp;
+                }
+
+                if (symmetry & 4u) {
+                    newCol = N - 1 - newCol;
+                }
+
+                setCell(result, newRow*N + newCol, getCell(board, row*N + col));
+            }
+        }
     }
 
-    /* Insert the value into one of the free spaces on the board */
-    unsigned int index = rand() % numZeros;
+    /**
+     * Writes the eight symmetric variants of the board to variants, in
+     * the order of the Symmetry enum.
+     */
+    static void getVariants(const uint64_t* board, uint64_t variants[NUM_SYMMETRIES][WORDS])
+    {
+        for (unsigned int k = 0; k < NUM_SYMMETRIES; ++k) {
+            transform(board, variants[k], static_cast<Symmetry>(k));
+        }
+    }
+
+    /**
+     * Lists the empty cells of the board in reading order, and returns
+     * how many there are.
+     */
+    static unsigned int getEmptyCells(const uint64_t* board, unsigned int* cells)
+    {
+        unsigned int numEmpty = 0;
 
-    unsigned int row = rowIndices[index];
-    unsigned int col = colIndices[index];
-    grid[row][col] = insertValue;
+        for (unsigned int cell = 0; cell < N*N; ++cell) {
+            if (getCell(board, cell) == 0) {
+                cells[numEmpty++] = cell;
+            }
+        }
 
-}
+        return numEmpty;
+    }
+};
 
 
-unsigned int State::getMaxTile() const
+/**
+ * The 4x4 board is a single 64-bit word, so each of its operations is
+ * a handful of table lookups or bit tricks on that word.
+ */
+template <>
+struct BoardOps<4>
 {
+    static unsigned int slideUp(uint64_t* board)
+    {
+        /**
+         * The columns of the board are the rows of its transpose, so the
+         * move engine slides the transposed rows and transposes them back.
+         * See moves.hpp for how the row lookup tables are laid out.
+         */
+        unsigned int reward;
+        board[0] = slideBoardUp(board[0], reward);
+        return reward;
+    }
+
+    static unsigned int slideDown(uint64_t* board)
+    {
+        unsigned int reward;
+        board[0] = slideBoardDown(board[0], reward);
+        return reward;
+    }
 
-    unsigned int maxTile = 0;
+    static unsigned int slideLeft(uint64_t* board)
+    {
+        unsigned int reward;
+        board[0] = slideBoardLeft(board[0], reward);
+        return reward;
+    }
 
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
+    static unsigned int slideRight(uint64_t* board)
+    {
+        unsigned int reward;
+        board[0] = slideBoardRight(board[0], reward);
+        return reward;
+    }
 
-            if (grid[row][col] > maxTile) {
-                maxTile = grid[row][col];
-            }
+    static unsigned int legalMoves(const uint64_t* board)
+    {
+        return legalBoardMoves(board[0]);
+    }
+
+    static void transform(const uint64_t* board, uint64_t* result, Symmetry symmetry)
+    {
+        uint64_t transformed = board[0];
+
+        for (unsigned int k = 0; k < (symmetry & 3u); ++k) {
+            transformed = rotateBoard(transformed);
+        }
+
+        if (symmetry & 4u) {
+            transformed = flipBoardHorizontal(transformed);
         }
+
+        result[0] = transformed;
     }
 
-    return maxTile;
-}
+    static void getVariants(const uint64_t* board, uint64_t variants[NUM_SYMMETRIES][1])
+    {
+        /* Generate the four rotations, and then each of them mirrored */
+        variants[IDENTITY][0] = board[0];
+        variants[ROTATE_90][0] = rotateBoard(board[0]);
+        variants[ROTATE_180][0] = flipBoardVertical(flipBoardHorizontal(board[0]));
+        variants[ROTATE_270][0] = rotateBoard(variants[ROTATE_180][0]);
+
+        for (unsigned int k = 0; k < 4; ++k) {
+            variants[k + 4][0] = flipBoardHorizontal(variants[k][0]);
+        }
+    }
+
+    static unsigned int getEmptyCells(const uint64_t* board, unsigned int* cells)
+    {
+        /* Fold each nibble onto its lowest bit, so that the low bit of a
+         * cell's nibble is set in emptyCells exactly when the cell is empty.
+         */
+        uint64_t occupied = board[0] | (board[0] >> 1);
+        occupied |= occupied >> 2;
+        uint64_t emptyCells = ~occupied & 0x1111111111111111ULL;
+
+        /* Walk the empty cells from the top of the board (the most
+         * significant nibble) downwards.
+         */
+        unsigned int numEmpty = 0;
+        while (emptyCells != 0) {
+            unsigned int shift = 63 - __builtin_clzll(emptyCells);
+            emptyCells &= ~(uint64_t(1) << shift);
+            cells[numEmpty++] = 15 - shift/4;
+        }
+
+        return numEmpty;
+    }
+};
 
 
-unsigned int State::slideUp()
+template <unsigned int N>
+void BasicState<N>::insertNewTile(Rng& rng)
 {
-    /**
-     * This code is quite similar to the action code used by
-     * Szubert and Jaskowski in their 2048 project. 
-     * You can find the original code here:
-     * https://github.com/mszubert/2048
-     */
-    unsigned int reward = 0;
+    /* Get the possible indices where we can insert a tile */
+    unsigned int emptyCells[NUM_CELLS];
+    unsigned int numZeros = BoardOps<N>::getEmptyCells(board, emptyCells);
 
-    for (int col = 0; col < 4; ++col) {
+    /* Choose whether to insert a 2 or a 4 */
+    unsigned int insertExponent;
+    if (rng.nextDouble() < TWO_PROBABILITY) {
+        insertExponent = 1;
+    } else {
+        insertExponent = 2;
+    }
 
-        int firstFreeRow = 0;
-        bool alreadyAggregated = false;
+    /* Insert the value into one of the free spaces on the board */
+    unsigned int index = rng.nextBelow(numZeros);
+    setCell(board, emptyCells[index], insertExponent);
+}
 
-        for (int row = 0; row < 4; ++row) {
 
-            if (grid[row][col] == 0) {
-                continue;
-            }
+template <unsigned int N>
+unsigned int BasicState<N>::getMaxTile() const
+{
 
-            if ((firstFreeRow > 0) && (!alreadyAggregated) && (grid[firstFreeRow-1][col] == grid[row][col])) {
-                grid[firstFreeRow - 1][col] *= 2;
-                grid[row][col] = 0;
-                reward += grid[firstFreeRow-1][col];
-                alreadyAggregated = true;
-            } else {
-                unsigned int temp = grid[row][col];
-                grid[row][col] = 0;
-                grid[firstFreeRow++][col] = temp;
-                alreadyAggregated = false;
+    unsigned int maxExponent = 0;
+
+    /* Every cell is a nibble, so walk the board four bits at a time */
+    for (unsigned int i = 0; i < BOARD_WORDS; ++i) {
+        for (uint64_t cells = board[i]; cells != 0; cells >>= 4) {
+
+            if ((cells & 0xF) > maxExponent) {
+                maxExponent = cells & 0xF;
             }
         }
     }
 
-    return reward;
+    return (maxExponent == 0) ? 0 : (1u << maxExponent);
 }
 
 
-unsigned int State::slideDown()
+template <unsigned int N>
+unsigned int BasicState<N>::slideUp()
 {
-    /**
-     * This member function is basically the same idea as for 
-     * the slideUp() member function, but we push and combine 
-     * the tiles in a different direction.
-     */
-    unsigned int reward = 0;
+    return BoardOps<N>::slideUp(board);
+}
 
-    for (int col = 0; col < GRID_SIZE; ++col) {
 
-        int firstFreeRow = 3;
-        bool alreadyAggregated = false;
+template <unsigned int N>
+unsigned int BasicState<N>::slideDown()
+{
+    return BoardOps<N>::slideDown(board);
+}
 
-        for (int row = GRID_SIZE-1; row >= 0; --row) {
 
-            if (grid[row][col] == 0) {
-                continue;
-            }
+template <unsigned int N>
+unsigned int BasicState<N>::slideRight()
+{
+    return BoardOps<N>::slideRight(board);
+}
 
-            if ((firstFreeRow < 3) && (!alreadyAggregated) && (grid[firstFreeRow+1][col] == grid[row][col])) {
-                grid[firstFreeRow + 1][col] *= 2;
-                grid[row][col] = 0;
-                reward += grid[firstFreeRow+1][col];
-                alreadyAggregated = true;
-            } else {
-                unsigned int temp = grid[row][col];
-                grid[row][col] = 0;
-                grid[firstFreeRow--][col] = temp;
-                alreadyAggregated = false;
-            }
-        }
-    }
 
-    return reward;
+template <unsigned int N>
+unsigned int BasicState<N>::slideLeft()
+{
+    return BoardOps<N>::slideLeft(board);
 }
 
 
-unsigned int State::slideRight()
+template <unsigned int N>
+unsigned int BasicState<N>::getLegalMoves() const
 {
-    /**
-     * This member function is basically the same idea as for 
-     * the slideUp() member function, but we push and combine 
-     * the tiles in a different direction.
-     */
-    unsigned int reward = 0;
+    return BoardOps<N>::legalMoves(board);
+}
 
-    for (int row = 0; row < GRID_SIZE; ++row) {
 
-        int firstFreeCol = 3;
-        bool alreadyAggregated = false;
+template <unsigned int N>
+bool BasicState<N>::isTerminal() const
+{
+    return BoardOps<N>::legalMoves(board) == 0;
+}
 
-        for (int col = GRID_SIZE-1; col >= 0; --col) {
 
-            if (grid[row][col] == 0) {
-                continue;
-            }
+template <unsigned int N>
+BasicState<N> BasicState<N>::transpose() const
+{
+    return applySymmetry(TRANSPOSE);
+}
 
-            if ((firstFreeCol < 3) && (!alreadyAggregated) && (grid[row][firstFreeCol+1] == grid[row][col])) {
-                grid[row][firstFreeCol+1] *= 2;
-                grid[row][col] = 0;
-                reward += grid[row][firstFreeCol+1];
-                alreadyAggregated = true;
-            } else {
-                unsigned int temp = grid[row][col];
-                grid[row][col] = 0;
-                grid[row][firstFreeCol--] = temp;
-                alreadyAggregated = false;
-            }
-        }
-    }
 
-    return reward;
+template <unsigned int N>
+BasicState<N> BasicState<N>::flipHorizontal() const
+{
+    return applySymmetry(FLIP_HORIZONTAL);
 }
 
 
-unsigned int State::slideLeft()
+template <unsigned int N>
+BasicState<N> BasicState<N>::flipVertical() const
 {
-    /**
-     * This member function is basically the same idea as for 
-     * the slideUp() member function, but we push and combine 
-     * the tiles in a different direction.
-     */
-    unsigned int reward = 0;
+    return applySymmetry(FLIP_VERTICAL);
+}
 
-    for (int row = 0; row < 4; ++row) {
 
-        int firstFreeCol = 0;
-        bool alreadyAggregated = false;
+template <unsigned int N>
+BasicState<N> BasicState<N>::rotate() const
+{
+    return applySymmetry(ROTATE_90);
+}
 
-        for (int col = 0; col < 4; ++col) {
 
-            if (grid[row][col] == 0) {
-                continue;
-            }
+template <unsigned int N>
+BasicState<N> BasicState<N>::applySymmetry(Symmetry symmetry) const
+{
+    BasicState result;
+    BoardOps<N>::transform(board, result.board, symmetry);
+    return result;
+}
 
-            if ((firstFreeCol > 0) && (!alreadyAggregated) && (grid[row][firstFreeCol-1] == grid[row][col])) {
-                grid[row][firstFreeCol-1] *= 2;
-                grid[row][col] = 0;
-                reward += grid[row][firstFreeCol-1];
-                alreadyAggregated = true;
-            } else {
-                unsigned int temp = grid[row][col];
-                grid[row][col] = 0;
-                grid[row][firstFreeCol++] = temp;
-                alreadyAggregated = false;
+
+template <unsigned int N>
+BasicState<N> BasicState<N>::canonical(Symmetry& symmetry) const
+{
+    uint64_t variants[NUM_SYMMETRIES][BOARD_WORDS];
+    BoardOps<N>::getVariants(board, variants);
+
+    /* Compare the variants word by word, most significant word first */
+    unsigned int best = 0;
+    for (unsigned int k = 1; k < NUM_SYMMETRIES; ++k) {
+        for (unsigned int i = 0; i < BOARD_WORDS; ++i) {
+            if (variants[k][i] != variants[best][i]) {
+                if (variants[k][i] < variants[best][i]) {
+                    best = k;
+                }
+                break;
             }
         }
     }
 
-    return reward;
+    BasicState result;
+    for (unsigned int i = 0; i < BOARD_WORDS; ++i) {
+        result.board[i] = variants[best][i];
+    }
+
+    symmetry = static_cast<Symmetry>(best);
+    return result;
 }
 
 
-void State::print() const
+template <unsigned int N>
+void BasicState<N>::print() const
 {
-    cout << "-----------------------------\n";
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-            if (grid[row][col] != 0) {
-                cout << '|' << setfill(' ') << setw(6) << grid[row][col];
+    string divider(7*N + 1, '-');
+
+    cout << divider << "\n";
+    for (unsigned int row = 0; row < N; ++row) {
+        for (unsigned int col = 0; col < N; ++col) {
+            if (getExponent(row, col) != 0) {
+                cout << '|' << setfill(' ') << setw(6) << getTile(row, col);
             } else {
                 cout << "|      ";
             }
-            
+
         }
-        cout << "|\n-----------------------------\n";
+        cout << "|\n" << divider << "\n";
     }
 }
 
 
-unsigned int State::getTile(unsigned int row, unsigned int col) const
-{
-    return grid[row][col];
-}
-
-
-bool State::setTile(unsigned int row, unsigned int col, unsigned int value)
+template <unsigned int N>
+bool BasicState<N>::setTile(unsigned int row, unsigned int col, unsigned int value)
 {
-    /* Remember, we only want to the value if the value is a power of 2 */
-    if (value % 2 == 0) {
-        grid[row][col] = value;
+    /* Remember, we only want to the value if the value is a power of 2
+     * that fits in a cell. A value of zero clears the cell.
+     */
+    if (value == 0) {
+        setExponent(row, col, 0);
         return true;
-    } else {
+    }
+
+    if (((value & (value - 1)) != 0) || (value == 1) || (value > (1u << MAX_EXPONENT))) {
         return false;
     }
+
+    unsigned int exponent = 0;
+    while ((1u << exponent) < value) {
+        exponent++;
+    }
+
+    setExponent(row, col, exponent);
+    return true;
 }
 
 
-unsigned int State::getEmptyTiles(unsigned int* rows, unsigned int* cols) const
+template <unsigned int N>
+void BasicState<N>::setExponent(unsigned int row, unsigned int col, unsigned int exponent)
 {
-    unsigned int numZeros = 0;
+    setCell(board, row*N + col, exponent);
+}
 
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
 
-            if (grid[row][col] == 0) {
-                rows[numZeros] = row;
-                cols[numZeros] = col;
-                numZeros++;
-            }
-        }
+template <unsigned int N>
+unsigned int BasicState<N>::getEmptyTiles(unsigned int* rows, unsigned int* cols) const
+{
+    unsigned int emptyCells[NUM_CELLS];
+    unsigned int numZeros = BoardOps<N>::getEmptyCells(board, emptyCells);
+
+    for (unsigned int i = 0; i < numZeros; ++i) {
+        rows[i] = emptyCells[i] / N;
+        cols[i] = emptyCells[i] % N;
     }
 
     return numZeros;
 }
 
 
-unsigned int State::getNextStates(State** nextStates, double* probabilities) const
+template <unsigned int N>
+unsigned int BasicState<N>::getNextStates(BasicState* nextStates, double* probabilities) const
 {
-    State afterState = (*this);
+    unsigned int emptyCells[NUM_CELLS];
+    unsigned int numEmptyTiles = BoardOps<N>::getEmptyCells(board, emptyCells);
 
-    unsigned int numNextStates = 0;
-    unsigned int numEmptyTiles;
-    unsigned int rowIndices[GRID_SIZE*GRID_SIZE];
-    unsigned int colIndices[GRID_SIZE*GRID_SIZE];
+    if (numEmptyTiles == 0) {
+        return 0;
+    }
 
-    numEmptyTiles = afterState.getEmptyTiles(rowIndices, colIndices);
+    double twoProbability = TWO_PROBABILITY * (1.0/double(numEmptyTiles));
+    double fourProbability = (1-TWO_PROBABILITY) * (1.0/double(numEmptyTiles));
+    unsigned int numNextStates = 0;
 
-    unsigned int row;
-    unsigned int col;
+    /* The empty cells are in reading order; insert a 2 and then a 4 */
     for (unsigned int i = 0; i < numEmptyTiles; ++i) {
 
-        row = rowIndices[i];
-        col = colIndices[i];
-
-        /* Insert the tile with value 2 */
-        afterState.setTile(row, col, 2);
-
-        nextStates[numNextStates] = new State{afterState};
-        probabilities[numNextStates] = TWO_PROBABILITY * (1.0/double(numEmptyTiles));
+        nextStates[numNextStates] = *this;
+        setCell(nextStates[numNextStates].board, emptyCells[i], 1);
+        probabilities[numNextStates] = twoProbability;
         numNextStates++;
 
-        /* Insert the tile with value 4 */
-        afterState.setTile(row, col, 4);
-
-        nextStates[numNextStates] = new State{afterState};
-        probabilities[numNextStates] = (1-TWO_PROBABILITY) * (1.0/double(numEmptyTiles));;
+        nextStates[numNextStates] = *this;
+        setCell(nextStates[numNextStates].board, emptyCells[i], 2);
+        probabilities[numNextStates] = fourProbability;
         numNextStates++;
-
-        afterState.setTile(row, col, 0);
     }
 
     return numNextStates;
 }
 
 
-bool State::operator==(const State& otherState) const
+template <unsigned int N>
+bool BasicState<N>::operator==(const BasicState& otherState) const
 {
     bool equal = true;
 
-    for (int row = 0; row < GRID_SIZE; ++row) {
-        for (int col = 0; col < GRID_SIZE; ++col) {
-
-            equal = equal && (grid[row][col] == otherState.grid[row][col]);
-        }
+    for (unsigned int i = 0; i < BOARD_WORDS; ++i) {
+        equal = equal && (board[i] == otherState.board[i]);
     }
 
     return equal;
 }
 
 
-bool State::operator!=(const State& otherState) const
+template <unsigned int N>
+bool BasicState<N>::operator!=(const BasicState& otherState) const
 {
     return !(*this == otherState);
 }
+
+
+/* Compile every supported board size */
+template class BasicState<3>;
+template class BasicState<4>;
+template class BasicState<5>;
+template class BasicState<6>;
@@ -7,27 +7,91 @@
 #ifndef STATE_H
 #define STATE_H 1
 
+#include <cstdint>
+#include "rng.hpp"
+
+/* Board size used by the programs, through the State, Game and NTNN types */
 #define GRID_SIZE 4
 #define TWO_PROBABILITY 0.9
 
+/* Smallest and largest board sizes the engine is built for */
+#define MIN_GRID_SIZE 3
+#define MAX_GRID_SIZE 6
+
+/* Largest exponent a cell can hold, so the largest tile is 2^15 = 32768 */
+#define MAX_EXPONENT 15
+
+/* Number of rotations and reflections of the board */
+#define NUM_SYMMETRIES 8
+
+/**
+ * This enum defines the rotations and reflections of the board (its
+ * dihedral symmetries). Symmetry k rotates the board clockwise by 
+ * 90*(k % 4) degrees, and then, for k >= 4, mirrors it left to right.
+ */
+enum Symmetry {IDENTITY, ROTATE_90, ROTATE_180, ROTATE_270,
+               FLIP_HORIZONTAL, TRANSPOSE, FLIP_VERTICAL, ANTI_TRANSPOSE};
+
 /**
- * This class represents a state for the game 2048.
+ * This class represents a state for the game 2048, played on an N x N
+ * board. The programs use the GRID_SIZE x GRID_SIZE board through the 
+ * State type defined below, but every size from MIN_GRID_SIZE to 
+ * MAX_GRID_SIZE is compiled, for quick small-board experiments and for
+ * larger stress runs.
+ *
+ * The grid is packed into 64-bit words. Each cell holds the base 2 
+ * exponent of its tile in 4 bits (0 means the cell is empty), and the
+ * cells are stored in reading order starting from the most significant
+ * nibble of the first word, sixteen cells per word. On the 4x4 board the
+ * whole grid is a single 64-bit board: cell (0, 0) lives in bits 60-63 and
+ * cell (3, 3) in bits 0-3, and each row occupies 16 contiguous bits, with
+ * row 0 on top. The 4x4 board uses the table-driven move engine (see 
+ * moves.hpp); the other sizes slide their tiles with loops whose bounds 
+ * are known at compile time.
  */
-class State {
+template <unsigned int N>
+class BasicState {
+
+public:
+
+    /* Width (and height) of the board */
+    static const unsigned int SIZE = N;
+
+    /* Number of cells on the board */
+    static const unsigned int NUM_CELLS = N*N;
+
+    /* Number of 64-bit words holding the board's cells */
+    static const unsigned int BOARD_WORDS = (N*N + 15) / 16;
+
+    /* Most next states a state can have: a 2 or a 4 in every cell */
+    static const unsigned int MAX_NEXT_STATES = 2*N*N;
 
 private:
 
-    /* The GRID_SIZE x GRID_SIZE array that defines a state */
-    unsigned int grid[GRID_SIZE][GRID_SIZE];
+    /* The packed N x N grid of tile exponents */
+    uint64_t board[BOARD_WORDS];
 
 public:
 
     /**
-     * The constructor for a State object.
+     * The constructor for a State object. The new state is empty; use
+     * insertNewTile() to place the starting tiles.
+     *
+     * :return: New State object
+     */
+    BasicState();
+
+    /**
+     * Constructs a State directly from a packed board, without inserting
+     * any tiles. See the class description for the board layout. The 
+     * board is the first 64-bit word of the grid, which is the whole grid
+     * on boards of up to 4x4; any further words start out empty.
+     *
+     * :param board: Packed board of tile exponents
      *
      * :return: New State object
      */
-    State();
+    explicit BasicState(uint64_t board);
 
     /**
      * The copy constructor for a State object.
@@ -36,7 +100,7 @@ public:
      *
      * :return: New State object
      */
-    State(const State& otherState);
+    BasicState(const BasicState& otherState) = default;
 
     /**
      * Assignment operator for a State object.
@@ -45,7 +109,25 @@ public:
      *
      * :return: New State object
      */
-    State& operator=(const State& otherState);
+    BasicState& operator=(const BasicState& otherState) = default;
+
+    /**
+     * Returns the packed 64-bit board which holds the tile exponents.
+     * On boards larger than 4x4, this is only the first of the words
+     * holding the grid.
+     *
+     * :return: Packed board of tile exponents
+     */
+    uint64_t getBoard() const;
+
+    /**
+     * Returns all of the packed words which hold the tile exponents. 
+     * Cell (row, col) is cell number i = row*N + col, which is stored in
+     * bits 60 - 4*(i % 16) to 63 - 4*(i % 16) of word i / 16.
+     *
+     * :return: Array of BOARD_WORDS packed words
+     */
+    const uint64_t* getBoardWords() const;
 
     /**
      * This function adds a new tile to the game state.
@@ -53,9 +135,11 @@ public:
      * with probability 0.1. Regardless of its value, the tile is placed
      * at random in any of the free spaces in the state.
      *
+     * :param rng: Random number generator of the game the state belongs to
+     *
      * :return: (None)
      */
-    void insertNewTile();
+    void insertNewTile(Rng& rng);
 
     /**
      * Searches the entire game state and returns the value of the tile
@@ -101,6 +185,76 @@ public:
      */
     unsigned int slideRight();
 
+    /**
+     * Finds which of the four moves would change the state, using one 
+     * table lookup per row and column rather than sliding the state.
+     *
+     * :return: Mask with bit 0 set if UP is legal, bit 1 for DOWN, bit 2 
+     *          for LEFT and bit 3 for RIGHT (the order of the Action enum)
+     */
+    unsigned int getLegalMoves() const;
+
+    /**
+     * Checks whether the state is terminal, that is, whether no move 
+     * can change it.
+     *
+     * :return: Whether the game is over in this state
+     */
+    bool isTerminal() const;
+
+    /**
+     * Returns the state reflected about its main diagonal, so that the
+     * rows become columns.
+     *
+     * :return: Transposed state
+     */
+    BasicState transpose() const;
+
+    /**
+     * Returns the state mirrored left to right.
+     *
+     * :return: Mirrored state
+     */
+    BasicState flipHorizontal() const;
+
+    /**
+     * Returns the state mirrored top to bottom.
+     *
+     * :return: Mirrored state
+     */
+    BasicState flipVertical() const;
+
+    /**
+     * Returns the state rotated by 90 degrees clockwise.
+     *
+     * :return: Rotated state
+     */
+    BasicState rotate() const;
+
+    /**
+     * Returns the state transformed by one of the eight symmetries.
+     *
+     * :param symmetry: Rotation or reflection to apply
+     *
+     * :return: Transformed state
+     */
+    BasicState applySymmetry(Symmetry symmetry) const;
+
+    /**
+     * Returns the canonical form of the state: of the eight symmetric
+     * variants of the state, the one whose cells come first in 
+     * lexicographic (reading) order. Because cell (0, 0) is the most 
+     * significant nibble of the board, this is simply the variant with
+     * the smallest packed board (comparing words in order on larger 
+     * boards). Symmetric states share a canonical form.
+     *
+     * :param symmetry: Symmetry which maps this state onto its canonical 
+     *                  form (return value)
+     *
+     * :return: Canonical form of the state
+     */
+    BasicState canonical(Symmetry& symmetry) const;
+
     /**
      * Prints the current values of the state's grid in a pretty way.
      * 
@@ -120,11 +274,21 @@ public:
      */
     unsigned int getTile(unsigned int row, unsigned int col) const;
 
+    /**
+     * Returns the base 2 exponent of the tile located in the specified row
+     * and column, or zero if no tile exists at that location.
+     *
+     * :param row: Row of the tile of interest
+     * :param col: Column of the tile of interest
+     *
+     * :return: Exponent of the tile located at the specified location
+     */
+    unsigned int getExponent(unsigned int row, unsigned int col) const;
 
     /**
      * Sets the value of a state's tile using the given row, column,
      * and desired new value. The new value should be a power of 2 and
-     * an integer.
+     * an integer no larger than 2^MAX_EXPONENT (or zero, to clear the tile).
      *
      * :param row: Row of the tile of interest
      * :param col: Column of the tile of interest
@@ -136,7 +300,8 @@ public:
 
     /**
      * Gets the locations and numbers of all empty tiles in the current
-     * state. Locations are returned in the supplied arrays.
+     * state. Locations are returned in the supplied arrays, which must 
+     * hold at least NUM_CELLS entries.
      *
      * :param rows: Row locations of the empty tiles
      * :param cols: Column locations of the empty tiles
@@ -148,16 +313,18 @@ public:
     /**
      * Gets the possible next states that can be reached from the current
      * game state. The function also computes the probability of reaching
-     * each of the next possible states. Note: users calling this function
-     * will need to free the memory allocated in nextStates. Yeah, this is 
-     * kind of icky, but it works and I'm feeling lazy right now.
+     * each of the next possible states. The states are written straight 
+     * into the caller's arrays, which must hold at least MAX_NEXT_STATES
+     * entries, so nothing is allocated on the heap. For each empty cell
+     * (in reading order) the state with a 2 comes first, then the one 
+     * with a 4.
      * 
-     * :param nextStates: Array of pointers to the possible next states
+     * :param nextStates: Array of the possible next states (return value)
      * :param probabilities: Probabilities corresponsing to each possible state
      *
      * :return: Number of possible next states
      */
-    unsigned int getNextStates(State** nextStates, double* probabilities) const;
+    unsigned int getNextStates(BasicState* nextStates, double* probabilities) const;
 
     /**
      * Overloaded relational operators for equality comparison
@@ -166,7 +333,7 @@ public:
      *
      * :return: Whether or not this state and the other are equal 
      */
-    bool operator==(const State& otherState) const;
+    bool operator==(const BasicState& otherState) const;
 
     /**
      * Overloaded relational operators for inequality comparison
@@ -175,8 +342,78 @@ public:
      *
      * :return: Whether or not this state and the other are not equal 
      */
-    bool operator!=(const State& otherState) const;
+    bool operator!=(const BasicState& otherState) const;
+
+private:
+
+    /**
+     * Sets the exponent of the tile located in the specified row and 
+     * column. This is the raw write underneath setTile().
+     *
+     * :param row: Row of the tile of interest
+     * :param col: Column of the tile of interest
+     * :param exponent: New exponent of the tile (zero clears the tile)
+     *
+     * :return: (None)
+     */
+    void setExponent(unsigned int row, unsigned int col, unsigned int exponent);
 
 };
 
+
+/* The accessors below are defined here rather than in state.cpp, so that
+ * they are inlined into the move engine, the NTNN and the programs.
+ */
+
+template <unsigned int N>
+inline BasicState<N>::BasicState()
+{
+    for (unsigned int i = 0; i < BOARD_WORDS; ++i) {
+        board[i] = 0;
+    }
+}
+
+
+template <unsigned int N>
+inline BasicState<N>::BasicState(uint64_t board)
+    : BasicState()
+{
+    this->board[0] = board;
+}
+
+
+template <unsigned int N>
+inline uint64_t BasicState<N>::getBoard() const
+{
+    return board[0];
+}
+
+
+template <unsigned int N>
+inline const uint64_t* BasicState<N>::getBoardWords() const
+{
+    return board;
+}
+
+
+template <unsigned int N>
+inline unsigned int BasicState<N>::getTile(unsigned int row, unsigned int col) const
+{
+    unsigned int exponent = getExponent(row, col);
+    return (exponent == 0) ? 0 : (1u << exponent);
+}
+
+
+template <unsigned int N>
+inline unsigned int BasicState<N>::getExponent(unsigned int row, unsigned int col) const
+{
+    /* Sixteen cells fit in each word, starting from its most significant nibble */
+    unsigned int cell = row*N + col;
+    return (board[cell / 16] >> (4*(15 - cell % 16))) & 0xF;
+}
+
+
+/* The board the programs play on */
+typedef BasicState<GRID_SIZE> State;
+
 #endif
@@ -64,8 +64,9 @@ Action getBestAction(const State& state, Action* actions, int numActions, const
     unsigned int reward;
     double value;
 
-    State* nextStates[2*GRID_SIZE*GRID_SIZE];
-    double probabilities[2*GRID_SIZE*GRID_SIZE];
+    State nextStates[State::MAX_NEXT_STATES];
+    double probabilities[State::MAX_NEXT_STATES];
+    double values[State::MAX_NEXT_STATES];
     unsigned int numNextStates;
 
     for (int i = 0; i < numActions; ++i) {
@@ -85,12 +86,11 @@ Action getBestAction(const State& state, Action* actions, int numActions, const
         }
 
         numNextStates = afterState.getNextStates(nextStates, probabilities);
+        V.evaluate(nextStates, numNextStates, values);
         value = double(reward);
 
         for (unsigned int j = 0; j < numNextStates; ++j) {
-            value += probabilities[j]*V.evaluate(*(nextStates[j]));
-            /* Don't forget to free the memory! */
-            delete nextStates[j];
+            value += probabilities[j]*values[j];
         }
 
         if (value > bestValue) {
@@ -108,10 +108,12 @@ Action getBestAction(const State& state, Action* actions, int numActions, const
  * the 2048 game states. The scores and outcomes of the games which
  * the algorithms played are stored in the given, pre-allocated arrays.
  *
+ * :param seed: Seed from which the seeds of the games are derived
+ *
  * :return: The results of the experiment (wins and scores as a function of
  *          number of games played)
  */
-Results stateLearning()
+Results stateLearning(uint64_t seed)
 {
     /* Create the struct to store the experiment results */
     Results results;
@@ -140,7 +142,7 @@ Results stateLearning()
     
     for (unsigned int gameIndex = 0; gameIndex < GAMES; ++gameIndex)
     {
-        Game game;
+        Game game{Rng::streamSeed(seed, gameIndex)};
         numActions = game.getActions(actions);
 
         State state;
@@ -206,11 +208,14 @@ Results stateLearning()
  */
 int main(int argc, char **argv)
 {
-    /* Initialize the random seed */
-    srand(time(NULL));
+    /* Every game's seed is derived from this master seed, so printing
+     * it lets us reproduce the experiment later on.
+     */
+    uint64_t masterSeed = time(NULL);
 
     cout << "Learning Rate: " << ALPHA << endl;
     cout << "Number of Games per Experiment: " << GAMES << endl;
+    cout << "Seed: " << masterSeed << endl;
 
     for (int experiment = 1; experiment <= NUM_EXPERIMENTS; ++experiment)
     {
@@ -218,7 +223,7 @@ int main(int argc, char **argv)
         cout << "Experiment " << experiment << " / " << NUM_EXPERIMENTS << endl;
 
         /* Collect the results from each of the experiments */
-        Results experimentResults = stateLearning();
+        Results experimentResults = stateLearning(Rng::streamSeed(masterSeed, experiment));
 
         /* Create the names of the results files */
         ostringstream scoresFileName;
@@ -0,0 +1,156 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#include "vecgame.hpp"
+#include "movekernel.hpp"
+#include "moves.hpp"
+
+
+VecGame::VecGame(unsigned int numGames, uint64_t masterSeed)
+    : numGames(numGames),
+      masterSeed(masterSeed),
+      episodes(numGames),
+      boards(numGames),
+      scores(numGames),
+      maxTiles(numGames),
+      moves(numGames),
+      done(numGames),
+      afterStates(NUM_ACTIONS*numGames),
+      rewards(NUM_ACTIONS*numGames),
+      legalMoves(numGames)
+{
+    /* Rng has no default constructor, so the generators are created
+     * here and seeded properly by reset().
+     */
+    rngs.reserve(numGames);
+    for (unsigned int i = 0; i < numGames; ++i) {
+        rngs.emplace_back(0);
+        reset(i);
+    }
+}
+
+
+unsigned int VecGame::getNumGames() const
+{
+    return numGames;
+}
+
+
+void VecGame::reset(unsigned int game)
+{
+    episodes[game] = numEpisodes++;
+    rngs[game] = Rng(Rng::streamSeed(masterSeed, episodes[game]));
+
+    /* Start by inserting two tiles into the grid, as Game does */
+    State state;
+    state.insertNewTile(rngs[game]);
+    state.insertNewTile(rngs[game]);
+
+    boards[game] = state.getBoard();
+    scores[game] = 0;
+    maxTiles[game] = state.getMaxTile();
+    moves[game] = 0;
+}
+
+
+void VecGame::expand()
+{
+    if (!expanded) {
+        expandBoards(boards.data(), numGames, afterStates.data(), rewards.data(), legalMoves.data());
+        expanded = true;
+    }
+}
+
+
+unsigned int VecGame::step(const Action* actions, EpisodeResult* results)
+{
+    unsigned int numResults = 0;
+
+    expand();
+
+    for (unsigned int i = 0; i < numGames; ++i) {
+
+        unsigned int a = actions[i];
+        done[i] = false;
+
+        /* An illegal move would not change the board, so skip it */
+        if ((a >= NUM_ACTIONS) || !(legalMoves[i] & (1u << a))) {
+            continue;
+        }
+
+        unsigned int reward = rewards[NUM_ACTIONS*i + a];
+        State state{afterStates[NUM_ACTIONS*i + a]};
+        state.insertNewTile(rngs[i]);
+
+        boards[i] = state.getBoard();
+        scores[i] += reward;
+        moves[i] += 1;
+
+        /* Either a merge or the new tile (a 4) can be the largest tile */
+        unsigned int maxTile = state.getMaxTile();
+        if (maxTile > maxTiles[i]) {
+            maxTiles[i] = maxTile;
+        }
+
+        /* Report the game if it just ended, and start a new one */
+        if (legalBoardMoves(boards[i]) == 0) {
+            EpisodeResult& result = results[numResults++];
+            result.game = i;
+            result.episode = episodes[i];
+            result.score = scores[i];
+            result.maxTile = maxTiles[i];
+            result.moves = moves[i];
+
+            done[i] = true;
+            reset(i);
+        }
+    }
+
+    expanded = false;
+    return numResults;
+}
+
+
+const uint64_t* VecGame::getBoards() const
+{
+    return boards.data();
+}
+
+
+const unsigned int* VecGame::getScores() const
+{
+    return scores.data();
+}
+
+
+const unsigned int* VecGame::getMaxTiles() const
+{
+    return maxTiles.data();
+}
+
+
+const unsigned char* VecGame::getDone() const
+{
+    return done.data();
+}
+
+
+const uint64_t* VecGame::getAfterStates() const
+{
+    return afterStates.data();
+}
+
+
+const unsigned int* VecGame::getRewards() const
+{
+    return rewards.data();
+}
+
+
+const unsigned char* VecGame::getLegalMoves() const
+{
+    return legalMoves.data();
+}
@@ -0,0 +1,165 @@
+/**
+ * Written by Andrew Donelick
+ * EELE 577 - Advanced Digital Signal Processing
+ * Final Project
+ */
+
+#ifndef VECGAME_H
+#define VECGAME_H 1
+
+#include <cstdint>
+#include <vector>
+#include "state.hpp"
+#include "game.hpp"
+#include "rng.hpp"
+
+
+/**
+ * This structure describes a game which a VecGame finished playing.
+ */
+struct EpisodeResult
+{
+    /* Index of the game (slot) within the VecGame */
+    unsigned int game;
+
+    /* Order in which the game was started, from 0 (the stream of its seed) */
+    uint64_t episode;
+
+    /* Final score of the game */
+    unsigned int score;
+
+    /* Value of the largest tile on the final board */
+    unsigned int maxTile;
+
+    /* Number of moves made during the game */
+    unsigned int moves;
+};
+
+
+/**
+ * Class which runs many 4x4 games of 2048 side by side. Rather than a
+ * Game object per game, the games are stored as a structure of arrays
+ * (one array of boards, one of scores, and so on), so that all of the
+ * live games can be expanded with a single call to the batched move
+ * kernel (see movekernel.hpp) and stepped with a single call to step().
+ *
+ * Whenever a game ends, its result is reported and a new game starts
+ * in its slot straight away, so every slot always holds a live game.
+ * The games are seeded from the master seed in the order in which they
+ * start, so a run with the same seed and the same moves is identical.
+ */
+class VecGame
+{
+
+private:
+
+    /* Number of games played side by side */
+    unsigned int numGames;
+
+    /* Seed from which the seed of every game is derived */
+    uint64_t masterSeed;
+
+    /* Number of games started so far (the stream of the next game) */
+    uint64_t numEpisodes = 0;
+
+    /* Episode number (order of starting) of each game */
+    std::vector<uint64_t> episodes;
+
+    /* Current packed board of each game */
+    std::vector<uint64_t> boards;
+
+    /* Current score of each game */
+    std::vector<unsigned int> scores;
+
+    /* Value of the largest tile on each game's board */
+    std::vector<unsigned int> maxTiles;
+
+    /* Number of moves made so far in each game */
+    std::vector<unsigned int> moves;
+
+    /* Whether each game ended (and was restarted) during the last step */
+    std::vector<unsigned char> done;
+
+    /* Random number generator used to spawn each game's tiles */
+    std::vector<Rng> rngs;
+
+    /* Afterstates, rewards and legal moves of the current boards */
+    std::vector<uint64_t> afterStates;
+    std::vector<unsigned int> rewards;
+    std::vector<unsigned char> legalMoves;
+
+    /* Whether the arrays above match the current boards */
+    bool expanded = false;
+
+public:
+
+    /**
+     * The constructor for a VecGame object. Every slot starts a new game.
+     *
+     * :param numGames: Number of games to play side by side
+     * :param masterSeed: Seed from which the seed of every game is derived
+     *
+     * :return: New VecGame object
+     */
+    VecGame(unsigned int numGames, uint64_t masterSeed);
+
+    /**
+     * Gets the number of games played side by side.
+     *
+     * :return: Number of games (slots)
+     */
+    unsigned int getNumGames() const;
+
+    /**
+     * Slides the current board of every game in all four directions, so
+     * that a policy can choose the games' next moves. Afterwards, the
+     * arrays returned by getAfterStates(), getRewards() and
+     * getLegalMoves() describe the current boards, laid out as for
+     * expandBoards(). Calling this function again before step() does
+     * nothing.
+     *
+     * :return: (None)
+     */
+    void expand();
+
+    /**
+     * Plays one move in every game, using the afterstates computed by
+     * expand() (which is called first if needed). Illegal moves leave a
+     * game unchanged. Each game that ends is reported in results and
+     * restarted.
+     *
+     * :param actions: Array with the move to make in each game
+     * :param results: Array with room for getNumGames() results of the
+     *                 games that ended during this step (return value)
+     *
+     * :return: Number of games that ended during this step
+     */
+    unsigned int step(const Action* actions, EpisodeResult* results);
+
+    /**
+     * These functions give read-only access to the state of the games.
+     * Entry i of each array belongs to game i. The afterstates, rewards
+     * and legal moves are only valid after expand().
+     */
+    const uint64_t* getBoards() const;
+    const unsigned int* getScores() const;
+    const unsigned int* getMaxTiles() const;
+    const unsigned char* getDone() const;
+    const uint64_t* getAfterStates() const;
+    const unsigned int* getRewards() const;
+    const unsigned char* getLegalMoves() const;
+
+private:
+
+    /**
+     * Starts a new game in the given slot.
+     *
+     * :param game: Slot in which to start the new game
+     *
+     * :return: (None)
+     */
+    void reset(unsigned int game);
+
+};
+
+#endif